@@ -0,0 +1,274 @@
+"""Benchmark report for a run.sh simulation.
+
+Reads the gateways' console logs and the 2G4 PHY dump, and prints, per
+gateway:
+
+  - discovery time and table size
+  - poll cycle time: from "=== Requesting DATA" to the LOSS lines that
+    close the cycle
+  - GETs, retries and timeouts, and the loss per polling mode from the
+    last LOSS lines
+  - status latency distribution, from the "Received ... in N ms" lines,
+    in the same buckets as the gateway's RTT histograms (rtt_hist.h)
+  - gateways that joined and left, see shard.h
+  - in passive mode, the publications forwarded and the repeats dropped,
+    from the "Published" and PUB lines
+
+and then the statuses per second over all gateways, and the airtime and
+packet count per node, from the PHY's Tx dumps. It exits with an error
+when the gateways' last sweeps together did not find every server.
+
+Only what happens after the first "Polling" line counts towards the
+cycle and latency figures, so discovery does not skew them.
+"""
+import argparse
+import csv
+import glob
+import os
+import re
+import sys
+
+# "d_00: @00:00:12.345678  text", as the bsim boards print the console
+PREFIX = re.compile(r'^d_\d+: @(\d+):(\d+):(\d+\.\d+)\s+(.*)$')
+
+CYCLE_START = re.compile(r'=== Requesting DATA')
+CYCLE_END = re.compile(r'^LOSS ')
+RECEIVED = re.compile(r'^Received .* from 0x([0-9a-fA-F]+) .* in (\d+) ms')
+TIMEOUT = re.compile(r'^Timeout ')
+RETRY = re.compile(r'^Retry ')
+LOSS = re.compile(r'^LOSS (\w+): cycles=(\d+) req=(\d+) retry=(\d+) rx=(\d+)/(\d+)')
+POLLING = re.compile(r'^Polling (\d+) sensors on (\d+) of (\d+) servers')
+DISCOVERED = re.compile(r'^Discovery done: (\d+) nodes, (\d+) sensors')
+SCHED = re.compile(r'^SCHED: (.*)$')
+JOINED = re.compile(r'^Gateway 0x[0-9a-fA-F]+ joined')
+GONE = re.compile(r'^Gateway 0x[0-9a-fA-F]+ is gone')
+PUBLISHED = re.compile(r'^Published ')
+PUB = re.compile(r'^PUB: forwarded=(\d+) dup=(\d+) unknown=(\d+)')
+
+# Bucket floors of rtt_hist.h: below 16 ms, then doubling
+RTT_BUCKETS = 12
+
+
+def bucket_floor(b):
+    return 0 if b == 0 else 16 << (b - 1)
+
+
+def percentile(values, pct):
+    if not values:
+        return 0
+    values = sorted(values)
+    return values[min(len(values) - 1, len(values) * pct // 100)]
+
+
+def parse_log(path):
+    """(time_s or None, text) per console line"""
+    with open(path, errors='replace') as f:
+        for line in f:
+            line = line.rstrip('\n')
+            m = PREFIX.match(line)
+            if m:
+                h, mnt, s, text = m.groups()
+                yield int(h) * 3600 + int(mnt) * 60 + float(s), text.strip()
+            else:
+                yield None, line.strip()
+
+
+def gateway_stats(path):
+    st = {
+        'discovery': None, 'servers': 0, 'polling': None, 'cycles': [], 'latency': [],
+        'timeouts': 0, 'retries': 0, 'loss': {}, 'sched': None,
+        'per_element': {}, 'joined': 0, 'gone': 0, 'published': 0, 'pub': None,
+    }
+    steady = False
+    cycle_at = None
+
+    for t, text in parse_log(path):
+        m = DISCOVERED.match(text)
+        if m:
+            # The first sweep for the timing, the last for what was found
+            if st['discovery'] is None:
+                st['discovery'] = (t, int(m.group(1)), int(m.group(2)))
+            st['servers'] = int(m.group(1))
+            continue
+
+        if JOINED.match(text):
+            st['joined'] += 1
+        elif GONE.match(text):
+            st['gone'] += 1
+
+        m = POLLING.match(text)
+        if m:
+            st['polling'] = tuple(map(int, m.groups()))
+            steady = True
+            continue
+
+        if not steady:
+            continue
+
+        if CYCLE_START.search(text):
+            cycle_at = t
+        elif CYCLE_END.match(text) and cycle_at is not None:
+            if t is not None:
+                st['cycles'].append(t - cycle_at)
+            cycle_at = None
+
+        m = RECEIVED.match(text)
+        if m:
+            ms = int(m.group(2))
+            st['latency'].append(ms)
+            st['per_element'].setdefault(int(m.group(1), 16), []).append(ms)
+        elif TIMEOUT.match(text):
+            st['timeouts'] += 1
+        elif RETRY.match(text):
+            st['retries'] += 1
+        elif PUBLISHED.match(text):
+            st['published'] += 1
+
+        m = PUB.match(text)
+        if m:
+            st['pub'] = tuple(map(int, m.groups()))
+
+        m = LOSS.match(text)
+        if m:
+            mode = m.group(1)
+            cycles, req, retry, rx, expected = map(int, m.groups()[1:])
+            st['loss'][mode] = (cycles, req, retry, rx, expected)
+
+        m = SCHED.match(text)
+        if m:
+            st['sched'] = m.group(1)
+
+    return st
+
+
+def airtime(dump_dir):
+    """{device: (packets, airtime_us)} from the d_2G4_*.Tx.csv dumps"""
+    out = {}
+    for path in glob.glob(os.path.join(dump_dir, 'd_2G4_*.Tx.csv')):
+        dev = int(re.search(r'd_2G4_(\d+)\.Tx\.csv$', path).group(1))
+        packets = 0
+        total = 0
+        with open(path, newline='') as f:
+            for row in csv.DictReader(f):
+                start = int(row['start_time'])
+                end = int(row['end_time'])
+                abort = int(row.get('abort_time') or end)
+                total += min(end, abort) - start + 1
+                packets += 1
+        out[dev] = (packets, total)
+    return out
+
+
+def gateway_report(st):
+    if st['discovery']:
+        t, nodes, sensors = st['discovery']
+        at = f"at {t:.1f} s" if t is not None else ''
+        print(f"Discovery: {nodes} nodes, {sensors} sensors {at}")
+    if st['polling']:
+        print(f"Polling: {st['polling'][0]} sensors on {st['polling'][1]} "
+              f"of {st['polling'][2]} servers")
+    if st['joined'] or st['gone']:
+        print(f"Gateways: {st['joined']} joined, {st['gone']} gone")
+
+    cycles = [c * 1000 for c in st['cycles']]
+    if cycles:
+        print(f"Cycles: {len(cycles)}, time avg {sum(cycles) / len(cycles):.0f} ms "
+              f"p50 {percentile(cycles, 50):.0f} p90 {percentile(cycles, 90):.0f} "
+              f"max {max(cycles):.0f} ms")
+    if st['sched']:
+        print(f"Scheduler: {st['sched']}")
+
+    print(f"Statuses: {len(st['latency'])}, timeouts {st['timeouts']}, "
+          f"retries {st['retries']}")
+    if st['pub']:
+        forwarded, dup, unknown = st['pub']
+        print(f"Published: {st['published']} forwarded, last PUB line "
+              f"{forwarded} forwarded, {dup} repeats, {unknown} not ours")
+    for mode, (cycles_n, req, retry, rx, expected) in st['loss'].items():
+        lost = expected - rx
+        pct = 100.0 * lost / expected if expected else 0.0
+        print(f"Loss {mode}: {cycles_n} cycles, {req} GETs + {retry} retries, "
+              f"{rx}/{expected} received, {pct:.1f} % lost")
+
+    lat = st['latency']
+    if lat:
+        print(f"Latency: p50 {percentile(lat, 50)} p90 {percentile(lat, 90)} "
+              f"p99 {percentile(lat, 99)} max {max(lat)} ms")
+        hist = [0] * RTT_BUCKETS
+        for ms in lat:
+            b = 0
+            while b + 1 < RTT_BUCKETS and ms >= bucket_floor(b + 1):
+                b += 1
+            hist[b] += 1
+        for b, n in enumerate(hist):
+            if n:
+                print(f"  >= {bucket_floor(b):5} ms: {n:7} {'#' * (60 * n // len(lat))}")
+
+        slowest = sorted(st['per_element'].items(),
+                         key=lambda kv: percentile(kv[1], 90), reverse=True)
+        # Statuses come from the element serving the sensor
+        print("Slowest elements (p90):")
+        for addr, values in slowest[:5]:
+            print(f"  0x{addr:04X}: p90 {percentile(values, 90)} ms over {len(values)} statuses")
+
+
+def report(args):
+    statuses = 0
+    found = 0
+
+    print(f"Servers: {args.servers}, gateways: {args.gateways}, simulated {args.seconds} s")
+    for path in args.log:
+        st = gateway_stats(path)
+        if len(args.log) > 1:
+            print(f"\n== Gateway {os.path.basename(path)}")
+        gateway_report(st)
+        statuses += len(st['latency']) + st['published']
+        found += st['servers']
+
+    print(f"\nThroughput: {statuses} statuses, {statuses / args.seconds:.1f} per s")
+
+    air = airtime(args.dump)
+    if air:
+        sim_us = args.seconds * 1_000_000
+        gws = [v for dev, v in air.items() if dev < args.gateways]
+        srv = [v for dev, v in air.items() if dev >= args.gateways]
+        gw = (sum(v[0] for v in gws), sum(v[1] for v in gws))
+        print(f"Airtime gateways: {gw[0]} packets, {gw[1] / 1000:.1f} ms "
+              f"({100.0 * gw[1] / sim_us:.2f} %)")
+        if srv:
+            avg = sum(v[1] for v in srv) / len(srv)
+            busiest = max(air.items(),
+                          key=lambda kv: kv[1][1] if kv[0] >= args.gateways else -1)
+            print(f"Airtime servers: avg {avg / 1000:.1f} ms ({100.0 * avg / sim_us:.2f} %), "
+                  f"busiest d_{busiest[0]:03} {busiest[1][1] / 1000:.1f} ms "
+                  f"in {busiest[1][0]} packets")
+        total = sum(v[1] for v in air.values())
+        print(f"Airtime all: {total / 1000:.1f} ms, {100.0 * total / sim_us:.2f} % of the simulated time")
+        if args.per_node:
+            for dev in sorted(air):
+                print(f"  d_{dev:03}: {air[dev][0]:6} packets {air[dev][1] / 1000:8.1f} ms")
+
+    # The gateways share the servers, so their last sweeps add up to all of them
+    if found != args.servers:
+        print(f"\nError: the gateways discovered {found} servers, not {args.servers}; "
+              f"the figures above do not cover the whole network", file=sys.stderr)
+        return 1
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--log', required=True, action='append',
+                        help="gateway console log, once per gateway")
+    parser.add_argument('--dump', required=True, help="PHY results directory")
+    parser.add_argument('--servers', type=int, required=True)
+    parser.add_argument('--seconds', type=int, required=True)
+    parser.add_argument('--gateways', type=int, default=1,
+                        help="devices 0 to gateways - 1 are gateways")
+    parser.add_argument('--per-node', action='store_true',
+                        help="airtime of every device")
+    return report(parser.parse_args())
+
+
+if __name__ == '__main__':
+    sys.exit(main())
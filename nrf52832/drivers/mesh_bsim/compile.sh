@@ -0,0 +1,33 @@
+#!/usr/bin/env bash
+#
+# Build sensor_client_network and sensor_server_lps28 for nrf52_bsim and
+# install them into ${BSIM_OUT_PATH}/bin. Needs a west workspace and
+# BabbleSim set up as for Zephyr's own BabbleSim tests (ZEPHYR_BASE,
+# BSIM_OUT_PATH and BSIM_COMPONENTS_PATH). With PASSIVE=1 the gateways
+# listen to publications instead of polling.
+#
+set -eu
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must be set}"
+
+here=$(cd "$(dirname "$0")" && pwd)
+drivers=$(dirname "$here")
+build_dir=${BUILD_DIR:-$here/build}
+passive=${PASSIVE:-0}
+
+build() {
+	app=$1
+	conf=$2
+	overlays=$3
+
+	west build -p auto --no-sysbuild -b nrf52_bsim -d "$build_dir/$app" "$drivers/$app" -- \
+		-DEXTRA_ZEPHYR_MODULES="$here" \
+		-DEXTRA_CONF_FILE="$here/boards/$conf" \
+		-DDTC_OVERLAY_FILE="$overlays" \
+		-DSIM_PASSIVE="$passive"
+
+	cp "$build_dir/$app/zephyr/zephyr.exe" "$BSIM_OUT_PATH/bin/bs_nrf52_bsim_$app"
+}
+
+build sensor_client_network client.conf "$here/boards/dk_io.overlay"
+build sensor_server_lps28 server.conf "$here/boards/dk_io.overlay;$here/boards/server.overlay"
@@ -0,0 +1,59 @@
+#ifndef _SIM_PROV_H_
+#define _SIM_PROV_H_
+
+#include <zephyr/bluetooth/mesh.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Self-provisioning for the BabbleSim benchmark.
+ *
+ * There is no phone in the simulation, so every device provisions
+ * itself into the same network with fixed keys and an address taken
+ * from its BabbleSim device number:
+ *
+ *   gateways   the first devices, gateway n at SIM_GATEWAY_ADDR(n)
+ *   servers    the devices after them, server n at SIM_SERVER_ADDR(n),
+ *              SIM_SERVER_STRIDE elements apart
+ *
+ * A device is a gateway if it has a Sensor Client. Then, through its own
+ * Config Client, it binds the application key to every model outside the
+ * foundation models, subscribes its Sensor Servers to SIM_POLL_GROUP_ADDR,
+ * its Sensor Client to SIM_PUB_GROUP_ADDR and its Gateway Shard model to
+ * SIM_SHARD_GROUP_ADDR.
+ *
+ * Built with SIM_PASSIVE, the servers' Sensor Servers also publish to
+ * SIM_PUB_GROUP_ADDR every SIM_PUB_PERIOD_S, sent SIM_PUB_COUNT + 1 times,
+ * for the gateways' passive ingest mode.
+ */
+#define SIM_GATEWAY_ADDR(n)     (0x0001 + (n))
+#define SIM_MAX_GATEWAYS        8
+#define SIM_SERVER_BASE         0x0010
+#define SIM_SERVER_STRIDE       8
+#define SIM_SERVER_ADDR(n)      (SIM_SERVER_BASE + ((n) - 1) * SIM_SERVER_STRIDE)
+
+/* POLL_GROUP_ADDR and SHARD_GROUP_ADDR of sensor_client_network */
+#define SIM_POLL_GROUP_ADDR     0xC010
+#define SIM_SHARD_GROUP_ADDR    0xC011
+
+/* PUB_GROUP_ADDR of sensor_client_network */
+#define SIM_PUB_GROUP_ADDR      0xC012
+#define SIM_PUB_PERIOD_S        10
+#define SIM_PUB_COUNT           1
+#define SIM_PUB_INTERVAL_MS     50
+
+/*
+ * Provision and configure the node, unless settings already had it
+ * provisioned. Configuration runs on a thread of its own, as the Config
+ * Client calls block. Call after bt_mesh_init() and settings_load().
+ * Returns 0 on success, or a negative error code.
+ */
+int sim_prov_start(const struct bt_mesh_comp *comp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_PROV_H_ */
@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+#
+# usage: run.sh [servers] [seconds] [gateways]
+#
+# Run N LPS28 servers (default 50) and one or more gateways sharing them
+# (default 1) for the given simulated time (default 600 s), then print
+# the analyze.py report. The logs, the PHY dump and the report end up in
+# results/<sim id>.
+#
+set -euo pipefail
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must be set}"
+
+servers=${1:-50}
+seconds=${2:-600}
+gateways=${3:-1}
+sim_id=${SIM_ID:-mesh_bench_${servers}x${gateways}}
+
+here=$(cd "$(dirname "$0")" && pwd)
+out=${OUT_DIR:-$here/results/$sim_id}
+bin=$BSIM_OUT_PATH/bin
+
+mkdir -p "$out"
+cd "$bin"
+
+# -dump writes every transmission to results/<sim id>/d_2G4_*.Tx.csv,
+# which is where the airtime figures come from
+./bs_2G4_phy_v1 -s="$sim_id" -D=$((gateways + servers)) \
+	-sim_length=$((seconds * 1000000)) -dump > "$out/phy.log" 2>&1 &
+
+logs=()
+for dev in $(seq 0 $((gateways - 1))); do
+	log=$out/$(printf 'd_%03d' "$dev").log
+	logs+=(--log "$log")
+	./bs_nrf52_bsim_sensor_client_network -s="$sim_id" -d="$dev" -rs=$((dev + 1)) \
+		> "$log" 2>&1 &
+done
+
+for dev in $(seq "$gateways" $((gateways + servers - 1))); do
+	./bs_nrf52_bsim_sensor_server_lps28 -s="$sim_id" -d="$dev" -rs=$((dev + 100)) \
+		> "$out/$(printf 'd_%03d' "$dev").log" 2>&1 &
+done
+
+wait
+
+python3 "$here/analyze.py" --servers "$servers" --seconds "$seconds" \
+	--gateways "$gateways" "${logs[@]}" --dump "$BSIM_OUT_PATH/results/$sim_id" 2>&1 \
+	| tee "$out/report.txt"
@@ -0,0 +1,142 @@
+/*
+ * Emulated LPS28DFW for the BabbleSim benchmark.
+ *
+ * Answers on the I2C emulator bus with just the registers lps28.c
+ * touches: WHOAMI, the one-shot trigger in CTRL_REG2, STATUS and the
+ * pressure and temperature outputs. Every one-shot takes a new sample
+ * from a slow random walk around a per-node offset, so servers report
+ * plausible, distinct and changing values.
+ */
+#define DT_DRV_COMPAT st_lps28_emul
+
+#include <string.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/random/random.h>
+
+#define LPS28_WHOAMI_REG     0x0F
+#define LPS28_CHIP_ID        0xB4
+#define LPS28_CTRL_REG2      0x11
+#define LPS28_STATUS_REG     0x27
+#define LPS28_PRESS_OUT_XL   0x28
+#define LPS28_TEMP_OUT_L     0x2B
+
+#define CTRL2_ONE_SHOT       BIT(0)
+#define CTRL2_SWRESET        BIT(2)
+#define STATUS_P_T_READY     0x03
+
+#define REG_COUNT            0x80
+
+/* Output scales, as lps28.c converts them */
+#define PRESS_LSB_PER_HPA    2048
+#define TEMP_LSB_PER_C       100
+
+struct lps28_emul_data {
+    uint8_t regs[REG_COUNT];
+    uint8_t reg;            /* register pointer, auto-incremented */
+    int32_t press;          /* PRESS_LSB_PER_HPA units */
+    int16_t temp;           /* TEMP_LSB_PER_C units */
+};
+
+/* Uniform in [-range, range] */
+static int32_t jitter(int32_t range)
+{
+    return (int32_t)(sys_rand32_get() % (2 * range + 1)) - range;
+}
+
+static void sample(struct lps28_emul_data *data)
+{
+    /* About 0.05 hPa and 0.05 °C per sample at most */
+    data->press += jitter(PRESS_LSB_PER_HPA / 20);
+    data->temp  += jitter(TEMP_LSB_PER_C / 20);
+
+    data->regs[LPS28_PRESS_OUT_XL]     = data->press;
+    data->regs[LPS28_PRESS_OUT_XL + 1] = data->press >> 8;
+    data->regs[LPS28_PRESS_OUT_XL + 2] = data->press >> 16;
+    data->regs[LPS28_TEMP_OUT_L]       = data->temp;
+    data->regs[LPS28_TEMP_OUT_L + 1]   = data->temp >> 8;
+    data->regs[LPS28_STATUS_REG]      |= STATUS_P_T_READY;
+}
+
+static void reset(struct lps28_emul_data *data)
+{
+    memset(data->regs, 0, sizeof(data->regs));
+    data->regs[LPS28_WHOAMI_REG] = LPS28_CHIP_ID;
+}
+
+static void reg_write(struct lps28_emul_data *data, uint8_t reg, uint8_t val)
+{
+    if (reg != LPS28_CTRL_REG2) {
+        data->regs[reg % REG_COUNT] = val;
+        return;
+    }
+
+    if (val & CTRL2_SWRESET) {
+        reset(data);
+        return;
+    }
+
+    /* The one-shot bit clears itself once the conversion is done */
+    data->regs[reg] = val & ~CTRL2_ONE_SHOT;
+    if (val & CTRL2_ONE_SHOT) {
+        sample(data);
+    }
+}
+
+static int lps28_emul_transfer(const struct emul *target, struct i2c_msg *msgs,
+                               int num_msgs, int addr)
+{
+    struct lps28_emul_data *data = target->data;
+
+    for (int i = 0; i < num_msgs; i++) {
+        struct i2c_msg *msg = &msgs[i];
+
+        if (msg->flags & I2C_MSG_READ) {
+            for (size_t j = 0; j < msg->len; j++) {
+                msg->buf[j] = data->regs[data->reg++ % REG_COUNT];
+            }
+            continue;
+        }
+
+        if (!msg->len) {
+            continue;
+        }
+
+        data->reg = msg->buf[0];
+        for (size_t j = 1; j < msg->len; j++) {
+            reg_write(data, data->reg++, msg->buf[j]);
+        }
+    }
+
+    return 0;
+}
+
+static const struct i2c_emul_api lps28_emul_api = {
+    .transfer = lps28_emul_transfer,
+};
+
+static int lps28_emul_init(const struct emul *target, const struct device *parent)
+{
+    struct lps28_emul_data *data = target->data;
+
+    reset(data);
+
+    /* Each simulated device has its own random seed, so its own weather */
+    data->press = 1013 * PRESS_LSB_PER_HPA + jitter(10 * PRESS_LSB_PER_HPA);
+    data->temp  = 21 * TEMP_LSB_PER_C + jitter(3 * TEMP_LSB_PER_C);
+    return 0;
+}
+
+/* lps28.c talks raw I2C to the node, which has no driver of its own; the
+ * emulator still needs a device to hang off.
+ */
+#define LPS28_EMUL(n)                                                        \
+    static struct lps28_emul_data lps28_emul_data_##n;                       \
+    DEVICE_DT_INST_DEFINE(n, NULL, NULL, NULL, NULL, POST_KERNEL,            \
+                          CONFIG_APPLICATION_INIT_PRIORITY, NULL);           \
+    EMUL_DT_INST_DEFINE(n, lps28_emul_init, &lps28_emul_data_##n, NULL,      \
+                        &lps28_emul_api, NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(LPS28_EMUL)
@@ -0,0 +1,163 @@
+#include "sim_prov.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/byteorder.h>
+#include <bluetooth/mesh/models.h>
+#include "bsim_args_runner.h"
+
+#define NET_IDX 0
+#define APP_IDX 0
+
+/* SIG models below this are foundation models, which take no AppKey */
+#define FIRST_APP_MODEL_ID 0x1000
+
+static const uint8_t net_key[16] = {
+    0x4c, 0x79, 0x73, 0x69, 0x6d, 0x65, 0x74, 0x65,
+    0x72, 0x2d, 0x62, 0x73, 0x69, 0x6d, 0x2d, 0x4e,
+};
+
+static const uint8_t app_key[16] = {
+    0x4c, 0x79, 0x73, 0x69, 0x6d, 0x65, 0x74, 0x65,
+    0x72, 0x2d, 0x62, 0x73, 0x69, 0x6d, 0x2d, 0x41,
+};
+
+static const struct bt_mesh_comp *comp;
+static uint16_t primary;
+
+static void configure(void *p1, void *p2, void *p3);
+
+/* Publication of the servers' Sensor Servers in SIM_PASSIVE builds */
+static int set_pub(uint16_t elem_addr, uint8_t *status)
+{
+    struct bt_mesh_cfg_cli_mod_pub pub = {
+        .addr     = SIM_PUB_GROUP_ADDR,
+        .app_idx  = APP_IDX,
+        .ttl      = BT_MESH_TTL_DEFAULT,
+        .period   = BT_MESH_PUB_PERIOD_SEC(SIM_PUB_PERIOD_S),
+        .transmit = BT_MESH_PUB_TRANSMIT(SIM_PUB_COUNT, SIM_PUB_INTERVAL_MS),
+    };
+
+    return bt_mesh_cfg_cli_mod_pub_set(NET_IDX, primary, elem_addr,
+                                       BT_MESH_MODEL_ID_SENSOR_SRV, &pub, status);
+}
+
+K_THREAD_DEFINE(sim_cfg, 2048, configure, NULL, NULL, NULL,
+                K_PRIO_PREEMPT(7), 0, SYS_FOREVER_MS);
+
+static void configure(void *p1, void *p2, void *p3)
+{
+    uint8_t status;
+    int err;
+
+    err = bt_mesh_cfg_cli_app_key_add(NET_IDX, primary, NET_IDX, APP_IDX, app_key, &status);
+    if (err || status) {
+        printk("Sim: AppKey Add failed (err %d, status %u)\n", err, status);
+        return;
+    }
+
+    for (size_t e = 0; e < comp->elem_count; e++) {
+        const struct bt_mesh_elem *elem = &comp->elem[e];
+        uint16_t elem_addr = primary + e;
+
+        for (size_t m = 0; m < elem->model_count; m++) {
+            uint16_t id = elem->models[m].id;
+
+            if (id < FIRST_APP_MODEL_ID) {
+                continue;
+            }
+
+            err = bt_mesh_cfg_cli_mod_app_bind(NET_IDX, primary, elem_addr, APP_IDX,
+                                               id, &status);
+            if (err || status) {
+                printk("Sim: bind 0x%04X on 0x%04X failed (err %d, status %u)\n",
+                       id, elem_addr, err, status);
+                continue;
+            }
+
+            if (id == BT_MESH_MODEL_ID_SENSOR_CLI) {
+                err = bt_mesh_cfg_cli_mod_sub_add(NET_IDX, primary, elem_addr,
+                                                  SIM_PUB_GROUP_ADDR, id, &status);
+            } else if (id == BT_MESH_MODEL_ID_SENSOR_SRV) {
+                err = bt_mesh_cfg_cli_mod_sub_add(NET_IDX, primary, elem_addr,
+                                                  SIM_POLL_GROUP_ADDR, id, &status);
+                if (IS_ENABLED(SIM_PASSIVE) && !err && !status) {
+                    err = set_pub(elem_addr, &status);
+                }
+            } else {
+                continue;
+            }
+            if (err || status) {
+                printk("Sim: configuring 0x%04X on 0x%04X failed (err %d, status %u)\n",
+                       id, elem_addr, err, status);
+            }
+        }
+
+        /* The only vendor model is the gateways' Gateway Shard */
+        for (size_t m = 0; m < elem->vnd_model_count; m++) {
+            const struct bt_mesh_model *mod = &elem->vnd_models[m];
+
+            err = bt_mesh_cfg_cli_mod_app_bind_vnd(NET_IDX, primary, elem_addr, APP_IDX,
+                                                   mod->vnd.id, mod->vnd.company, &status);
+            if (!err && !status) {
+                err = bt_mesh_cfg_cli_mod_sub_add_vnd(NET_IDX, primary, elem_addr,
+                                                      SIM_SHARD_GROUP_ADDR, mod->vnd.id,
+                                                      mod->vnd.company, &status);
+            }
+            if (err || status) {
+                printk("Sim: vendor model 0x%04X on 0x%04X failed (err %d, status %u)\n",
+                       mod->vnd.id, elem_addr, err, status);
+            }
+        }
+    }
+
+    printk("Sim: node 0x%04X configured\n", primary);
+}
+
+int sim_prov_start(const struct bt_mesh_comp *node_comp)
+{
+    unsigned int dev = bsim_args_get_global_device_nbr();
+    uint8_t dev_key[16];
+    int err;
+
+    if (bt_mesh_is_provisioned()) {
+        return 0;
+    }
+
+    comp = node_comp;
+
+    if (IS_ENABLED(CONFIG_BT_MESH_SENSOR_CLI)) {
+        if (dev >= SIM_MAX_GATEWAYS) {
+            printk("Sim: gateway on device %u, %u gateways at most\n",
+                   dev, SIM_MAX_GATEWAYS);
+            return -EINVAL;
+        }
+        primary = SIM_GATEWAY_ADDR(dev);
+    } else {
+        if (!dev) {
+            printk("Sim: device 0 is a gateway\n");
+            return -EINVAL;
+        }
+        primary = SIM_SERVER_ADDR(dev);
+    }
+
+    if (!IS_ENABLED(CONFIG_BT_MESH_SENSOR_CLI) && comp->elem_count > SIM_SERVER_STRIDE) {
+        printk("Sim: %u elements do not fit in the address stride\n", comp->elem_count);
+        return -E2BIG;
+    }
+
+    /* Unique per node, and never needed by anyone else */
+    memcpy(dev_key, net_key, sizeof(dev_key));
+    sys_put_le16(primary, &dev_key[14]);
+
+    err = bt_mesh_provision(net_key, NET_IDX, 0, 0, primary, dev_key);
+    if (err) {
+        printk("Sim: provisioning as 0x%04X failed (err %d)\n", primary, err);
+        return err;
+    }
+
+    printk("Sim: device %u provisioned as 0x%04X\n", dev, primary);
+    k_thread_start(sim_cfg);
+    return 0;
+}
@@ -49,16 +49,27 @@ static void motion_timeout(struct k_work *work)
 	printk("Area is now vacant.\n");
 }
 
+/* Entries still waiting for a value this cycle. The last reply raises
+ * cycle_done, which wakes report_work.
+ */
+static atomic_t pending;
+static struct k_poll_signal cycle_done;
+
 static void sensor_cli_data_cb(struct bt_mesh_sensor_cli *cli, struct bt_mesh_msg_ctx *ctx,
 			       const struct bt_mesh_sensor_type *sensor,
 			       const struct bt_mesh_sensor_value *value)
 {
+	/* No break: a property may be listed more than once */
 	for (int i = 0; i < SENSOR_COUNT; i++) {
 		if (sensor->id == sensor_table[i].id) {
 			sensor_table[i].value = *value;
-			sensor_table[i].valid = true;
+			if (!sensor_table[i].valid) {
+				sensor_table[i].valid = true;
+				if (atomic_dec(&pending) == 1) {
+					k_poll_signal_raise(&cycle_done, 0);
+				}
+			}
 			//printk("Received %s (id=0x%04X)\n", sensor_table[i].name, sensor->id);
-			break;
 		}
 	}
 }
@@ -105,7 +116,128 @@ static const struct bt_mesh_sensor_cli_handlers bt_mesh_sensor_cli_handlers = {
 static struct bt_mesh_sensor_cli sensor_cli = BT_MESH_SENSOR_CLI_INIT(&bt_mesh_sensor_cli_handlers);
 
 static struct k_work_delayable get_data_work;
+static struct k_work_poll report_work;
+static struct k_poll_event report_event =
+	K_POLL_EVENT_STATIC_INITIALIZER(K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY,
+					&cycle_done, 0);
+
+#define RESPONSE_TIMEOUT_MS 5000
+
+/* Entries still missing at the timeout are asked for again, up to RETRY_MAX
+ * rounds. Round n waits RETRY_BACKOFF_MS << n for the answers, and no more
+ * than RETRY_BUDGET GETs are re-sent per cycle.
+ */
+#define RETRY_MAX        3
+#define RETRY_BACKOFF_MS 500
+#define RETRY_BUDGET     8
+
+static uint32_t retry_round;
+static uint32_t retry_budget;
+
+/* Re-send a GET for every sensor type that has an entry still missing.
+ * Returns the number of GETs sent.
+ */
+static uint32_t retry_missing(void)
+{
+	uint32_t sent = 0;
+
+	for (int i = 0; i < SENSOR_COUNT && retry_budget; i++) {
+		bool dup = false;
+
+		if (sensor_table[i].valid) {
+			continue;
+		}
+
+		/* The same property may be listed twice, ask once */
+		for (int j = 0; j < i; j++) {
+			if (!sensor_table[j].valid && sensor_table[j].id == sensor_table[i].id) {
+				dup = true;
+				break;
+			}
+		}
+		if (dup) {
+			continue;
+		}
+
+		//printk("Retrying %s\n", sensor_table[i].name);
+		if (!bt_mesh_sensor_cli_get(&sensor_cli, NULL, sensor_table[i].type, NULL)) {
+			retry_budget--;
+			sent++;
+		}
+	}
 
+	return sent;
+}
+
+/* Runs once every entry has a value, or RESPONSE_TIMEOUT_MS after the last
+ * GET, whichever comes first. Nothing blocks the system workqueue meanwhile.
+ */
+static void report(struct k_work *work)
+{
+	unsigned int signaled;
+	int result;
+
+	k_poll_signal_check(&cycle_done, &signaled, &result);
+	if (!signaled) {
+		//printk("Timeout waiting for all responses.\n");
+
+		/* Ask again for what is missing only, and wait a little longer
+		 * every round.
+		 */
+		if (retry_round < RETRY_MAX && retry_missing()) {
+			k_work_poll_submit(&report_work, &report_event, 1,
+					   K_MSEC(RETRY_BACKOFF_MS << retry_round));
+			retry_round++;
+			return;
+		}
+	}
+
+	// Print results:
+	// printk("\n=== SENSOR REPORT ===\n");
+	// for (int i = 0; i < SENSOR_COUNT; i++) {
+	// 	if (sensor_table[i].valid) {
+	// 		printk("%s: %s\n",
+	// 			sensor_table[i].name,
+	// 			bt_mesh_sensor_ch_str(&sensor_table[i].value));
+	// 	} else {
+	// 		printk("%s: (no response)\n", sensor_table[i].name);
+	// 	}
+	// }
+	// printk("====================\n");
+
+	// 🚀 Print CSV HEADER once (optional, for first time only)
+	static uint32_t last_names_print_time = 0;
+
+	uint32_t now = k_uptime_get_32();
+	if (now - last_names_print_time > 10000) {  // every 10 seconds
+		printk("NAMES:timestamp_ms");
+		for (int i = 0; i < SENSOR_COUNT; i++) {
+			printk(",%s", sensor_table[i].name);
+		}
+		printk("\n");
+
+		last_names_print_time = now;
+	}
+
+	// 🚀 Print CSV DATA ROW
+	printk("VALUES:");
+	uint32_t timestamp_ms = k_uptime_get_32();
+	printk("%u", timestamp_ms);
+	for (int i = 0; i < SENSOR_COUNT; i++) {
+		if (sensor_table[i].valid) {
+			// Optional: parse value to float/int here
+			float val_f = 0.0f;
+			bt_mesh_sensor_value_to_float(&sensor_table[i].value, &val_f);
+			printk(",%.2f", (double)val_f);
+		} else {
+			printk(",");  // empty if no response
+		}
+	}
+	printk("\n");
+
+	// Next round:
+	k_work_schedule(&get_data_work, K_MSEC(GET_DATA_INTERVAL));
+}
 
 static void get_data(struct k_work *work)
 {
@@ -122,6 +254,10 @@ static void get_data(struct k_work *work)
 		for (int i = 0; i < SENSOR_COUNT; i++) {
 			sensor_table[i].valid = false;
 		}
+		k_poll_signal_reset(&cycle_done);
+		atomic_set(&pending, SENSOR_COUNT);
+		retry_round = 0;
+		retry_budget = RETRY_BUDGET;
 		//printk("\n=== Requesting SENSOR DATA ===\n");
 	}
 
@@ -138,81 +274,10 @@ static void get_data(struct k_work *work)
 
 	// If finished cycle:
 	if (sensor_idx >= SENSOR_COUNT) {
-
-		#define RESPONSE_TIMEOUT_MS 5000
-
-		uint32_t start = k_uptime_get_32();
-
-		while (true) {
-			bool all_received = true;
-
-			for (int i = 0; i < SENSOR_COUNT; i++) {
-				if (!sensor_table[i].valid) {
-					all_received = false;
-					break;
-				}
-			}
-
-			if (all_received) {
-				//printk("All sensors responded!\n");
-				break;
-			}
-
-			if (k_uptime_get_32() - start > RESPONSE_TIMEOUT_MS) {
-				//printk("Timeout waiting for all responses.\n");
-				break;
-			}
-
-			k_sleep(K_MSEC(50)); // short poll
-		}
-
-
-		// Print results:
-		// printk("\n=== SENSOR REPORT ===\n");
-		// for (int i = 0; i < SENSOR_COUNT; i++) {
-		// 	if (sensor_table[i].valid) {
-		// 		printk("%s: %s\n",
-		// 			sensor_table[i].name,
-		// 			bt_mesh_sensor_ch_str(&sensor_table[i].value));
-		// 	} else {
-		// 		printk("%s: (no response)\n", sensor_table[i].name);
-		// 	}
-		// }
-		// printk("====================\n");
-
-		// 🚀 Print CSV HEADER once (optional, for first time only)
-		static uint32_t last_names_print_time = 0;
-
-		uint32_t now = k_uptime_get_32();
-		if (now - last_names_print_time > 10000) {  // every 10 seconds
-			printk("NAMES:timestamp_ms");
-			for (int i = 0; i < SENSOR_COUNT; i++) {
-				printk(",%s", sensor_table[i].name);
-			}
-			printk("\n");
-
-			last_names_print_time = now;
-		}
-
-		// 🚀 Print CSV DATA ROW
-		printk("VALUES:");
-		uint32_t timestamp_ms = k_uptime_get_32();
-		printk("%u", timestamp_ms);
-		for (int i = 0; i < SENSOR_COUNT; i++) {
-			if (sensor_table[i].valid) {
-				// Optional: parse value to float/int here
-				float val_f = 0.0f;
-				bt_mesh_sensor_value_to_float(&sensor_table[i].value, &val_f);
-				printk(",%.2f", (double)val_f);
-			} else {
-				printk(",");  // empty if no response
-			}
-		}
-		printk("\n");
-
-		// Reset for next round:
+		// Reset for next round, report once the last reply lands:
 		sensor_idx = 0;
-		k_work_schedule(&get_data_work, K_MSEC(GET_DATA_INTERVAL));
+		k_work_poll_submit(&report_work, &report_event, 1,
+				   K_MSEC(RESPONSE_TIMEOUT_MS));
 	} else {
 		// Continue to next sensor:
 		k_work_schedule(&get_data_work, K_MSEC(GET_DATA_INTERVAL_QUICK));
@@ -361,6 +426,8 @@ const struct bt_mesh_comp *model_handler_init(void)
 {
 	k_work_init_delayable(&attention_blink_work, attention_blink);
 	k_work_init_delayable(&get_data_work, get_data);
+	k_work_poll_init(&report_work, report);
+	k_poll_signal_init(&cycle_done);
 	k_work_init_delayable(&motion_timeout_work, motion_timeout);
 
 	dk_button_handler_add(&button_handler);
@@ -0,0 +1,114 @@
+/*
+ * Reply dispatch benchmark.
+ *
+ * Builds the sensor_table[] shape of sensor_client_network for a large
+ * deployment and resolves every (element address, property ID) pair
+ * both with the old linear scan and with the dispatch index.
+ *
+ *   west build -b native_sim bench/dispatch && west build -t run
+ *
+ * Key comparisons per lookup are the figure to compare on native_sim,
+ * where simulated time does not advance while the CPU is busy. Cycle
+ * counts are only meaningful on hardware (nrf52dk/nrf52832).
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include "dispatch.h"
+
+#define N_SERVERS   100
+#define N_SENSORS   8
+#define N_RECORDS   (N_SERVERS * N_SENSORS)
+#define ROUNDS      16
+
+/* Unicast ranges handed out by the provisioner, one block per server */
+#define FIRST_ADDR  0x0037
+#define ADDR_STRIDE 0x10
+
+static const uint16_t prop_ids[N_SENSORS] = {
+    0x004E, 0x004D, 0x0068, 0x004C, 0x0054, 0x004F, 0x0073, 0x7F01,
+};
+
+/* Same fields the old sensor_cli_data_cb() compared */
+static struct {
+    uint16_t addr;
+    uint16_t prop_id;
+} records[N_RECORDS];
+
+static uint32_t scan_compares;
+
+static int scan_find(uint16_t addr, uint16_t prop_id)
+{
+    for (int i = 0; i < N_RECORDS; i++) {
+        scan_compares++;
+        if (records[i].prop_id == prop_id && records[i].addr == addr) {
+            return i;
+        }
+    }
+
+    return -ENOENT;
+}
+
+static void build(void)
+{
+    dispatch_reset();
+
+    for (int srv = 0; srv < N_SERVERS; srv++) {
+        for (int s = 0; s < N_SENSORS; s++) {
+            int i = srv * N_SENSORS + s;
+
+            records[i].addr = FIRST_ADDR + srv * ADDR_STRIDE + s;
+            records[i].prop_id = prop_ids[s];
+            dispatch_add(records[i].addr, records[i].prop_id, i);
+        }
+    }
+}
+
+typedef int (*find_fn)(uint16_t addr, uint16_t prop_id);
+
+static uint32_t run(find_fn find, uint32_t *errors)
+{
+    uint32_t start = k_cycle_get_32();
+
+    for (int r = 0; r < ROUNDS; r++) {
+        /* Walk the replies in an order unrelated to the table layout */
+        for (int n = 0; n < N_RECORDS; n++) {
+            int i = (n * 389) % N_RECORDS;
+
+            if (find(records[i].addr, records[i].prop_id) != i) {
+                (*errors)++;
+            }
+        }
+    }
+
+    return k_cycle_get_32() - start;
+}
+
+int main(void)
+{
+    const uint32_t lookups = ROUNDS * N_RECORDS;
+    uint32_t errors = 0;
+    uint32_t scan_cyc, hash_cyc;
+
+    build();
+
+    printk("dispatch bench: %d records, %u slots (load %u %%), %u lookups\n",
+           N_RECORDS, DISPATCH_SLOTS, 100 * dispatch_count() / DISPATCH_SLOTS, lookups);
+
+    scan_cyc = run(scan_find, &errors);
+    hash_cyc = run(dispatch_find, &errors);
+
+    printk("scan: %u compares/lookup, %u cycles/lookup\n",
+           scan_compares / lookups, scan_cyc / lookups);
+    printk("hash: %u.%02u probes/lookup, %u cycles/lookup\n",
+           dispatch_probes() / lookups, (100 * dispatch_probes() / lookups) % 100,
+           hash_cyc / lookups);
+
+    /* Unknown senders must miss, not alias onto a record */
+    if (dispatch_find(0x7FFF, prop_ids[0]) != -ENOENT ||
+        dispatch_find(FIRST_ADDR, 0x1234) != -ENOENT) {
+        errors++;
+    }
+
+    printk("%s (%u mismatches)\n", errors ? "FAIL" : "PASS", errors);
+    return 0;
+}
@@ -0,0 +1,135 @@
+#ifndef _DISCOVERY_H_
+#define _DISCOVERY_H_
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/mesh.h>
+#include <bluetooth/mesh/models.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sensor server discovery.
+ *
+ * Sweeps a unicast address range for nodes, learns which of their
+ * elements host a Sensor Server and which properties each one serves,
+ * and persists the result so the gateway comes back up with the same
+ * poll table after a reboot.
+ *
+ * Nodes are found with Config Composition Data Get (page 0), which
+ * needs the node's device key. For nodes the gateway has no device key
+ * for (provisioned from the phone), Composition Data Get cannot be
+ * sent, and the address is probed with Sensor Descriptor Get over the
+ * application key instead. The elements that answer are grouped into
+ * nodes by address: a run of consecutive answering addresses is one
+ * node, and an element serving the same first property as the run's
+ * first element starts the next one. What does not fit in the tables is
+ * counted and reported when the sweep finishes.
+ */
+
+/* Sized for about 30 LPS28 servers with their load cells. A sensor costs
+ * the gateway some 80 bytes of RAM over all its tables, see README.rst.
+ */
+#ifndef DISCOVERY_MAX_NODES
+#define DISCOVERY_MAX_NODES     48
+#endif
+#ifndef DISCOVERY_MAX_SENSORS
+#define DISCOVERY_MAX_SENSORS   256
+#endif
+
+/* Unicast range swept for nodes */
+#define DISCOVERY_ADDR_MIN      0x0001
+#ifndef DISCOVERY_ADDR_MAX
+#define DISCOVERY_ADDR_MAX      0x00FF
+#endif
+
+struct discovery_node {
+    uint16_t addr;          /* primary element */
+    uint8_t  elem_count;
+    uint8_t  hops;          /* see discovery_hops(), 0 if unknown */
+};
+
+struct discovery_sensor {
+    uint16_t addr;          /* element serving the property */
+    uint16_t prop_id;
+    uint8_t  node;          /* index into the node list */
+};
+
+/*
+ * TTL the servers send statuses with when they are not scoped to the
+ * gateway path (gw_path.h in sensor_server_lps28): their default TTL.
+ * Descriptor Statuses and publications are never scoped, GET responses
+ * are once the server knows how far the gateway is.
+ */
+#define DISCOVERY_SERVER_TTL    7
+
+/* Time between background sweeps once a table exists */
+#define DISCOVERY_REFRESH_MS    (60 * 60 * 1000)
+
+/*
+ * Set up discovery. Descriptor Gets go out through cli.
+ */
+void discovery_init(struct bt_mesh_sensor_cli *cli);
+
+/*
+ * Set which nodes a sweep keeps, by primary address (for a node probed
+ * blind, the first address of its group). A node keep() turns down is not
+ * probed any further and takes no room in the table, so DISCOVERY_MAX_NODES
+ * and DISCOVERY_MAX_SENSORS only bound what this gateway polls. The
+ * elements of a blind node still get the one Descriptor Get that groups
+ * them. NULL keeps every node.
+ */
+void discovery_set_filter(bool (*keep)(uint16_t addr));
+
+/*
+ * Start a sweep in the background. The current table stays valid
+ * until the sweep finishes.
+ * Returns 0 on success, or -EBUSY if a sweep is already running.
+ */
+int discovery_start(void);
+
+/*
+ * The filter's answers have changed: sweep again now, or right after the
+ * running sweep, which may have asked the old filter.
+ */
+void discovery_refilter(void);
+
+/* Whether a table has been discovered or restored from settings */
+bool discovery_has_table(void);
+
+/*
+ * Bumped every time a new table is published. Users compare it with
+ * the value they built their state from, and rebuild on a change.
+ */
+uint32_t discovery_generation(void);
+
+/*
+ * Current table. Call both together, from the system workqueue. The
+ * nodes handed out stay as they are until the next call after a new
+ * table has been published, so they can be read from any thread for as
+ * long as the caller builds on them. The sensors are only good until the
+ * caller returns to the workqueue; copy what is needed.
+ * Returns the number of entries.
+ */
+size_t discovery_nodes(const struct discovery_node **nodes);
+size_t discovery_sensors(const struct discovery_sensor **sensors);
+
+/*
+ * Hops a status has come, from the TTL it arrived with. Returns 0 if that
+ * is not known, for a scoped status: its TTL was just enough to get here,
+ * whatever the distance.
+ */
+uint8_t discovery_hops(uint8_t recv_ttl);
+
+/* Feed Config Client Composition Data Status messages */
+void discovery_comp_data(uint16_t addr, uint8_t page, struct net_buf_simple *buf);
+
+/* Feed Sensor Descriptor Status entries */
+void discovery_sensor_desc(struct bt_mesh_msg_ctx *ctx, const struct bt_mesh_sensor_info *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DISCOVERY_H_ */
@@ -0,0 +1,57 @@
+#ifndef _DISPATCH_H_
+#define _DISPATCH_H_
+
+#include <zephyr/types.h>
+#include <zephyr/sys/util.h>
+#include "discovery.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Reply dispatch index: maps (element address, property ID) of an
+ * incoming sensor status to its record in sensor_table.
+ *
+ * Open addressing with linear probing in a fixed power-of-two table.
+ * Sized at twice DISCOVERY_MAX_SENSORS rounded up to a power of two,
+ * which keeps the load under 50 % and the average lookup at one or two
+ * probes. Entries are never removed one by one; the index is rebuilt
+ * with dispatch_reset() + dispatch_add() whenever the server set changes.
+ */
+#ifndef DISPATCH_SLOTS_LOG2
+#define DISPATCH_SLOTS_LOG2 (LOG2CEIL(DISCOVERY_MAX_SENSORS) + 1)
+#endif
+#define DISPATCH_SLOTS      (1U << DISPATCH_SLOTS_LOG2)
+
+/* Drop all entries */
+void dispatch_reset(void);
+
+/*
+ * Map (addr, prop_id) to record index idx, replacing an existing
+ * mapping for the same key.
+ * Returns 0 on success, -EINVAL for an unassigned address, or -ENOMEM
+ * when the table is full.
+ */
+int dispatch_add(uint16_t addr, uint16_t prop_id, uint16_t idx);
+
+/*
+ * Look up the record index for (addr, prop_id).
+ * Returns the index, or -ENOENT if there is no such record.
+ */
+int dispatch_find(uint16_t addr, uint16_t prop_id);
+
+/* Number of entries in the index */
+uint32_t dispatch_count(void);
+
+/*
+ * Slots inspected by dispatch_find() since the last dispatch_reset(),
+ * for checking the probe length against the load factor.
+ */
+uint32_t dispatch_probes(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DISPATCH_H_ */
@@ -0,0 +1,178 @@
+#ifndef _FRAME_H_
+#define _FRAME_H_
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Binary records on the console UART.
+ *
+ * Each record is COBS encoded and sent between two 0x00 delimiters, so
+ * the host can pick the frames out of the printk text around them and
+ * resynchronise on the next 0x00 after any corruption. Decoded, a frame
+ * is (all fields little endian):
+ *
+ *   u8  version        FRAME_VERSION
+ *   u8  type           FRAME_TYPE_*
+ *   u16 seq            +1 per frame, gaps are frames lost on the way
+ *   u32 timestamp_ms   gateway uptime
+ *   ... payload        by type, see below
+ *   u16 crc            CRC-16/MCRF4XX (crc16_ccitt, seed 0xFFFF) of the
+ *                      bytes before it
+ *
+ * FRAME_TYPE_READINGS, the readings of one server from one poll cycle:
+ *
+ *   u16 server         primary element address
+ *   u8  count
+ *   count times:
+ *     u16 addr         element the sensor is on
+ *     u16 prop_id
+ *     u8  status       FRAME_STATUS_*
+ *     u16 age_ms       time since the status came in, saturating
+ *     i8  rssi         dBm, of the last hop the status came over
+ *     u8  ttl          the status arrived with
+ *     u8  hops         to the server, 0 if unknown (see discovery.h)
+ *     u8  len          0 unless status is FRAME_STATUS_OK; rssi and ttl
+ *                      are 0 then too
+ *     len bytes        the value as encoded on the mesh (the property's
+ *                      characteristic format), first channel only
+ *
+ * FRAME_TYPE_PATH, the path statistics of one server since boot, after its
+ * readings (or every report in passive mode):
+ *
+ *   u16 server         primary element address
+ *   u8  up             0 if the server is down
+ *   u32 tx             GETs sent
+ *   u32 rx             statuses received
+ *   u32 lost           GETs that timed out
+ *   u32 late           statuses after their GET timed out
+ *   u32 dup            statuses for a reading already in
+ *   u16 rtt_p50_ms     saturating, as the three below
+ *   u16 rtt_p90_ms
+ *   u16 rtt_max_ms
+ *   u8  ttl            of the last status
+ *   u8  hops           0 if unknown
+ *   i8  rssi_avg       dBm, over rssi_count statuses
+ *   i8  rssi_min
+ *   i8  rssi_max
+ *   u32 rssi_count
+ *
+ * FRAME_TYPE_SERIES, entries of one Sensor Series Status, split over as
+ * many frames as it takes (see series.h). timestamp_ms is when the status
+ * came in:
+ *
+ *   u16 addr           element the sensor is on
+ *   u16 prop_id
+ *   u8  total          entries in the status
+ *   u8  count          entries in this frame
+ *   count times:
+ *     u8  index        0 to total - 1
+ *     u8  channels
+ *     channels times:
+ *       u8  len
+ *       len bytes      the channel as encoded on the mesh; for the
+ *                      standard series types, the value and then the
+ *                      column
+ *
+ * The host sends frames the other way with the same header and framing,
+ * types from 0x80 up; timestamp_ms is not used. Each is answered with a
+ * text line starting with the command name or ERR, see host_cmd.h.
+ *
+ * FRAME_TYPE_PLAN, a new poll plan (see poll_plan.h):
+ *
+ *   u16 timeout_ms     default GET timeout, 0 for the built-in one
+ *   u8  flags          POLL_PLAN_*
+ *   u8  server_count   0 polls every discovered server
+ *   server_count times:
+ *     u16 addr         primary element
+ *   u8  prop_count
+ *   prop_count times:
+ *     u16 prop_id
+ *     u32 period_ms    0 stops polling the property
+ *     u16 timeout_ms   0 for the plan's timeout_ms
+ *
+ * A plan with no servers, no props and no flags goes back to the
+ * built-in poll classes.
+ *
+ * The decoder is rpi5/bluetooth/frame_decoder.py. Bump FRAME_VERSION on
+ * any change to the layout and teach the decoder the new one.
+ */
+#define FRAME_VERSION           2
+
+#define FRAME_TYPE_READINGS     0x01
+#define FRAME_TYPE_SERIES       0x02
+#define FRAME_TYPE_PATH         0x03
+#define FRAME_TYPE_PLAN         0x81
+
+#define FRAME_STATUS_OK         0
+#define FRAME_STATUS_TIMEOUT    1   /* asked, no status */
+#define FRAME_STATUS_FAILED     2   /* GET could not be sent */
+#define FRAME_STATUS_SKIPPED    3   /* server down, not asked */
+
+/* Largest frame before COBS, CRC included. Keeps the COBS overhead at one
+ * byte.
+ */
+#define FRAME_MAX               254
+
+/* Header size; the payload starts here */
+#define FRAME_HDR_SIZE          8
+
+struct frame {
+    uint8_t buf[FRAME_MAX];
+    size_t  len;
+    bool    overflow;
+};
+
+/* Start a frame of the given type with the common header */
+void frame_begin(struct frame *frame, uint8_t type, uint32_t timestamp_ms);
+
+void frame_put_u8(struct frame *frame, uint8_t val);
+void frame_put_le16(struct frame *frame, uint16_t val);
+void frame_put_le32(struct frame *frame, uint32_t val);
+void frame_put_bytes(struct frame *frame, const void *data, size_t len);
+
+/* Room left for payload, with the CRC accounted for */
+size_t frame_room(const struct frame *frame);
+
+/*
+ * Append the CRC, COBS encode the frame and queue it on uart_out.
+ * Returns 0 on success, -ENOSPC if the payload did not fit, or -ENOBUFS
+ * if the UART is behind; nothing is sent in either case.
+ */
+int frame_send(struct frame *frame);
+
+/*
+ * COBS encode and queue a frame that has already been sealed by
+ * frame_send(), as is, for replays.
+ * Returns 0 on success, or -ENOBUFS if the UART is behind.
+ */
+int frame_write(const uint8_t *buf, size_t len);
+
+/*
+ * COBS encode len bytes of in into out, which must have room for
+ * len + len / 254 + 1 bytes. The result contains no 0x00.
+ * Returns the encoded length.
+ */
+size_t frame_cobs_encode(const uint8_t *in, size_t len, uint8_t *out);
+
+/*
+ * COBS decode len bytes of in, without delimiters, into out, which needs
+ * room for len bytes. out may be in itself.
+ * Returns the decoded length, or -EBADMSG if in is not valid COBS.
+ */
+int frame_cobs_decode(const uint8_t *in, size_t len, uint8_t *out);
+
+/*
+ * Check the version and CRC of a decoded frame.
+ * Returns the length without the CRC, or -EBADMSG.
+ */
+int frame_check(const uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRAME_H_ */
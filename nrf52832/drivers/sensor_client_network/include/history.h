@@ -0,0 +1,38 @@
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * RAM history of the frames sent on the UART, so a host that restarts or
+ * gets replugged can catch up. Every sealed frame (see frame.h) is kept
+ * until HISTORY_SIZE bytes of newer frames push it out; with ten servers
+ * of a handful of sensors each that is the last eight or so cycles.
+ * Only frames are kept, not the log text around them.
+ *
+ * A "RESUME <seq>" line from the host replays every frame sent after
+ * seq, with its original seq, as fast as the UART takes them. Live frames
+ * keep going out in between, so the host has to reorder by seq.
+ */
+#define HISTORY_SIZE 4096
+
+/* Keep a copy of a sealed frame, CRC included */
+void history_add(const uint8_t *frame, size_t len);
+
+/*
+ * Replay the frames sent after seq. If seq is no longer held, which is
+ * also the case after a gateway reboot, everything held is replayed.
+ * A replay already running is restarted.
+ * Returns the number of frames queued for replay.
+ */
+int history_resume(uint16_t seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HISTORY_H_ */
@@ -0,0 +1,38 @@
+#ifndef _HOST_CMD_H_
+#define _HOST_CMD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Commands from the host on the UART, one per line, words separated by
+ * spaces:
+ *
+ *   RESUME <seq>   replay the frames sent after seq, see history.h
+ *   PLAN           print the poll plan, see poll_plan.h
+ *   PLAN RESET     go back to the built-in poll classes
+ *   SHARD          print the gateways sharing the servers, see shard.h
+ *   SERIES <addr> <prop_id> [<start> <width>]
+ *                  fetch the columns of a series sensor, all or those in
+ *                  the range, see series.h
+ *
+ * and as frames, for what does not fit on a line (see frame.h):
+ *
+ *   FRAME_TYPE_PLAN   replace the poll plan, answered "PLAN <seq> ok"
+ *
+ * Replies and errors are printk text lines starting with the command
+ * name or ERR.
+ */
+
+/*
+ * Start listening for commands. Needs uart_out_init() first.
+ * Returns 0 on success, or a negative error code.
+ */
+int host_cmd_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HOST_CMD_H_ */
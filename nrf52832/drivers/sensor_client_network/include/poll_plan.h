@@ -0,0 +1,78 @@
+#ifndef _POLL_PLAN_H_
+#define _POLL_PLAN_H_
+
+#include <zephyr/types.h>
+#include <zephyr/sys/util.h>
+#include "discovery.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Poll plan: which of the discovered sensors get polled, how often, and
+ * how long their GETs may stay unanswered. The host pushes a plan with a
+ * FRAME_TYPE_PLAN frame (see frame.h); it is saved in settings and comes
+ * back after a reboot.
+ *
+ * The empty plan, which is also what a fresh gateway has, polls every
+ * discovered sensor at the period of its built-in poll class.
+ */
+#define POLL_PLAN_MAX_SERVERS   DISCOVERY_MAX_NODES
+#define POLL_PLAN_MAX_PROPS     16
+
+/* Sensors whose property is not in props[] are not polled */
+#define POLL_PLAN_ONLY_LISTED   BIT(0)
+
+struct poll_plan_prop {
+    uint16_t prop_id;
+    uint16_t timeout_ms;    /* 0: the plan's timeout_ms */
+    uint32_t period_ms;     /* 0: not polled */
+};
+
+struct poll_plan {
+    uint16_t timeout_ms;    /* 0: built-in default */
+    uint8_t  flags;         /* POLL_PLAN_* */
+    uint8_t  server_count;  /* 0: every discovered server */
+    uint8_t  prop_count;    /* 0: built-in classes for all */
+    uint16_t servers[POLL_PLAN_MAX_SERVERS];    /* primary addresses */
+    struct poll_plan_prop props[POLL_PLAN_MAX_PROPS];
+};
+
+/*
+ * Current plan. Only replaced from the system workqueue, so it is stable
+ * for work items running on it.
+ */
+const struct poll_plan *poll_plan_get(void);
+
+/*
+ * Bumped every time the plan changes. Users compare it with the value
+ * they built their state from, and rebuild on a change.
+ */
+uint32_t poll_plan_generation(void);
+
+/*
+ * Take a FRAME_TYPE_PLAN payload, replace the current plan with it and
+ * save it. Call from the system workqueue.
+ * Returns 0 on success, or -EINVAL if the payload is malformed, in which
+ * case the current plan stays.
+ */
+int poll_plan_set(const uint8_t *payload, size_t len);
+
+/* Go back to the empty plan, and forget the saved one */
+void poll_plan_reset(void);
+
+/* Whether the plan polls the server with primary address addr */
+bool poll_plan_has_server(const struct poll_plan *plan, uint16_t addr);
+
+/* The plan's entry for prop_id, or NULL */
+const struct poll_plan_prop *poll_plan_prop(const struct poll_plan *plan, uint16_t prop_id);
+
+/* Print the plan as PLAN text lines */
+void poll_plan_print(const struct poll_plan *plan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _POLL_PLAN_H_ */
@@ -0,0 +1,40 @@
+#ifndef _RTT_HIST_H_
+#define _RTT_HIST_H_
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Log-bucketed round-trip time histogram. Bucket 0 counts RTTs below
+ * 16 ms, bucket b counts [2^(b+3), 2^(b+4)) ms, and the last bucket
+ * everything from 16 s up. Bucket counts saturate at UINT16_MAX, the
+ * totals do not.
+ */
+#define RTT_HIST_BUCKETS 12
+
+struct rtt_hist {
+    uint16_t bucket[RTT_HIST_BUCKETS];
+    uint32_t count;
+    uint32_t sum_ms;
+    uint32_t max_ms;
+};
+
+void rtt_hist_add(struct rtt_hist *hist, uint32_t rtt_ms);
+
+/* Lowest RTT counted in bucket b */
+uint32_t rtt_hist_bucket_floor(int b);
+
+/*
+ * Upper bound of the bucket the pct-th percentile falls in, or the
+ * largest RTT seen for the last bucket. 0 when the histogram is empty.
+ */
+uint32_t rtt_hist_percentile(const struct rtt_hist *hist, unsigned int pct);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTT_HIST_H_ */
@@ -0,0 +1,81 @@
+#ifndef _SCHED_H_
+#define _SCHED_H_
+
+#include <zephyr/types.h>
+#include "discovery.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Deadline scheduler for polling. Every (server, poll group) pair is an
+ * entry with its own period and next deadline, kept in a binary min-heap
+ * on the deadline. The poller pops the entries that are due, polls the
+ * records behind them, and puts them all back with sched_done() once the
+ * replies are in.
+ *
+ * An entry is only added for a pair with at least one sensor behind it,
+ * so there are never more entries than sensors, however many periods the
+ * poll plan adds.
+ */
+#ifndef SCHED_MAX_ENTRIES
+#define SCHED_MAX_ENTRIES DISCOVERY_MAX_SENSORS
+#endif
+
+struct sched_entry {
+    uint32_t deadline_ms;   /* uptime */
+    uint32_t period_ms;
+    uint8_t  server;
+    uint8_t  group;
+};
+
+struct sched_stats {
+    uint32_t dispatched;    /* entries popped */
+    uint32_t late_sum_ms;   /* time popped past the deadline, summed */
+    uint32_t late_max_ms;
+    uint32_t overruns;      /* whole periods missed */
+    uint32_t busy_ms;       /* time spent polling */
+    uint32_t since_ms;      /* uptime the stats start at */
+};
+
+/* Drop all entries and restart the stats */
+void sched_reset(uint32_t now);
+
+/*
+ * Add an entry, first due at first_ms.
+ * Returns 0 on success, or -ENOMEM when the heap is full.
+ */
+int sched_add(uint8_t server, uint8_t group, uint32_t period_ms, uint32_t first_ms);
+
+/*
+ * Pop the earliest entry into *out if it is due at now. The scheduler
+ * keeps the entry until sched_done().
+ * Returns true if an entry was popped.
+ */
+bool sched_pop_due(uint32_t now, struct sched_entry *out);
+
+/*
+ * Put every entry popped since the last call back, each due one period
+ * after its last deadline. If that has already passed, it is moved to
+ * now + period and the missed periods are counted as overruns, so no
+ * backlog builds up.
+ */
+void sched_done(uint32_t now);
+
+/*
+ * Time until the earliest deadline, 0 if one is due, or -1 if there are
+ * no entries.
+ */
+int32_t sched_next_in(uint32_t now);
+
+/* Account time spent polling, for the utilization figure */
+void sched_busy(uint32_t ms);
+
+const struct sched_stats *sched_stats_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SCHED_H_ */
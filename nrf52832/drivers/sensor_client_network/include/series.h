@@ -0,0 +1,49 @@
+#ifndef _SERIES_H_
+#define _SERIES_H_
+
+#include <zephyr/types.h>
+#include <bluetooth/mesh/models.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Bulk fetch of sensor series (history buckets, histogram columns).
+ *
+ * One Sensor Series Get returns every column in the range in a single
+ * segmented status, instead of one GET per column. Fetches are queued
+ * and sent one at a time, so at most one segmented exchange is on the
+ * air next to the poll window. The entries go out as FRAME_TYPE_SERIES
+ * frames (see frame.h), or as SERIES text lines, stamped with the time
+ * the status came in.
+ */
+#define SERIES_QUEUE_LEN        16
+
+/* Time for the whole segmented status to come in */
+#define SERIES_TIMEOUT_MS       5000
+
+/*
+ * Set up series fetches through cli, with binary or text output.
+ */
+void series_init(struct bt_mesh_sensor_cli *cli, bool binary);
+
+/*
+ * Queue a fetch of the columns of type at element addr that fall in
+ * range, or of all of them if range is NULL.
+ * Returns 0 on success, -EINVAL if type is not a series type, -EALREADY
+ * if the same fetch is already queued, or -ENOMEM if the queue is full.
+ */
+int series_fetch(uint16_t addr, const struct bt_mesh_sensor_type *type,
+                 const struct bt_mesh_sensor_column *range);
+
+/* Feed Sensor Series Status entries */
+void series_entry(struct bt_mesh_msg_ctx *ctx, const struct bt_mesh_sensor_type *type,
+                  uint8_t index, uint8_t count,
+                  const struct bt_mesh_sensor_series_entry *entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SERIES_H_ */
@@ -0,0 +1,82 @@
+#ifndef _SHARD_H_
+#define _SHARD_H_
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sharding of the servers over several gateways.
+ *
+ * Every gateway sends a beacon to SHARD_GROUP_ADDR every SHARD_BEACON_MS,
+ * and keeps the gateways it hears from as its peers. Each discovered
+ * server is polled by exactly one of the live gateways: the one whose
+ * address gives the highest shard_weight() for the server's address
+ * (rendezvous hashing). All gateways that see the same peers agree on
+ * the split without talking about it, and a new or lost gateway only
+ * moves the servers it gains or had.
+ *
+ * A peer that has not been heard from for SHARD_PEER_TIMEOUT_MS is gone,
+ * and its servers go to whoever has the next highest weight for them,
+ * so a dead gateway's shard is spread over the others.
+ *
+ * Mesh heartbeats cannot carry this, as a node only keeps a single
+ * heartbeat subscription source. The beacon is a vendor model message
+ * instead: bind the application key to the Gateway Shard model and
+ * subscribe it to SHARD_GROUP_ADDR on every gateway.
+ *
+ * Discovery only keeps the servers in this gateway's shard, so the table
+ * limits in discovery.h apply per gateway, and N gateways hold up to N
+ * times as many servers. A change of peers has the network swept again.
+ *
+ * A poll plan with a server list (see poll_plan.h) is an assignment from
+ * the host, and is polled as it is, without hashing or takeover.
+ */
+#define SHARD_GROUP_ADDR        0xC011
+#define SHARD_MAX_GATEWAYS      8
+#define SHARD_BEACON_MS         10000
+#define SHARD_PEER_TIMEOUT_MS   (3 * SHARD_BEACON_MS + SHARD_BEACON_MS / 2)
+
+#define SHARD_MODEL_ID          0x0001
+#define SHARD_OP_BEACON         BT_MESH_MODEL_OP_3(0x01, CONFIG_BT_COMPANY_ID)
+
+extern const struct bt_mesh_model_op _shard_op[];
+extern const struct bt_mesh_model_cb _shard_cb;
+
+/* The Gateway Shard vendor model, for the primary element */
+#define SHARD_MODEL                                                            \
+    BT_MESH_MODEL_VND_CB(CONFIG_BT_COMPANY_ID, SHARD_MODEL_ID, _shard_op,     \
+                         NULL, NULL, &_shard_cb)
+
+/*
+ * Whether server (a node's primary address) is in this gateway's shard.
+ * Call from the system workqueue.
+ */
+bool shard_owns(uint16_t server);
+
+/*
+ * Whether the gateway has listened long enough after boot to know its
+ * peers. Until then shard_owns() would claim servers a peer is polling.
+ */
+bool shard_ready(void);
+
+/*
+ * Bumped every time a peer comes or goes. Users compare it with the value
+ * they built their state from, and rebuild on a change.
+ */
+uint32_t shard_generation(void);
+
+/* Servers this gateway polls, sent along in its beacons */
+void shard_set_polled(uint16_t servers);
+
+/* Print the gateways and their loads as SHARD text lines */
+void shard_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHARD_H_ */
@@ -0,0 +1,76 @@
+#ifndef _UART_OUT_H_
+#define _UART_OUT_H_
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Gateway output on the console UART.
+ *
+ * Writers only copy their bytes into a ring buffer; the UART's EasyDMA
+ * sends straight out of the ring with the async API, and the TX done
+ * interrupt starts the next chunk. A slow or stalled host therefore
+ * never blocks a mesh callback or the workqueue: once the ring is full,
+ * new output is dropped and counted instead.
+ *
+ * uart_out_init() also takes over printk, so log text and the binary
+ * frames from frame.h share the ring.
+ *
+ * The host talks back on the same UART, see host_cmd.h: in text lines,
+ * or in COBS frames between 0x00 delimiters like the ones it receives.
+ * Whatever comes in is handed to the system workqueue one line or frame
+ * at a time; one that comes in while the previous one is still being
+ * handled is dropped.
+ */
+#define UART_OUT_BUF_SIZE 4096
+
+/* Longest line from the host, terminator included */
+#define UART_OUT_LINE_MAX 64
+
+/* Longest frame from the host, COBS encoded, without the delimiters */
+#define UART_OUT_FRAME_MAX 256
+
+struct uart_out_stats {
+    uint32_t bytes;          /* handed to the UART */
+    uint32_t dropped_bytes;
+    uint32_t dropped_writes; /* uart_out_write() calls refused */
+    uint32_t high_water;     /* most bytes queued at once */
+    uint32_t dropped_lines;  /* host lines or frames too long or too fast */
+};
+
+/* Called with each line from the host, without the line ending */
+typedef void (*uart_out_line_cb_t)(char *line);
+
+/* Called with each frame from the host, still COBS encoded */
+typedef void (*uart_out_frame_cb_t)(uint8_t *buf, size_t len);
+
+/*
+ * Set up async TX on the console UART and redirect printk.
+ * Returns 0 on success, or a negative error code, in which case printk
+ * stays on the console driver.
+ */
+int uart_out_init(void);
+
+/*
+ * Queue len bytes as one unit: either all of them go out, in one piece,
+ * or none do. Safe from any thread.
+ * Returns 0 on success, or -ENOBUFS if there was no room.
+ */
+int uart_out_write(const void *data, size_t len);
+
+/*
+ * Start receiving host lines and frames.
+ * Returns 0 on success, or a negative error code.
+ */
+int uart_out_rx_start(uart_out_line_cb_t line_cb, uart_out_frame_cb_t frame_cb);
+
+void uart_out_stats_get(struct uart_out_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UART_OUT_H_ */
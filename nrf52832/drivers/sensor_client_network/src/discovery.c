@@ -0,0 +1,601 @@
+#include "discovery.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/bluetooth/mesh/cfg_cli.h>
+
+/* Spacing between probes, so a sweep does not flood the advertiser */
+#define DISCOVERY_PROBE_MS      50
+
+/* Time to wait for stragglers after the last probe of a phase */
+#define DISCOVERY_SETTLE_MS     3000
+
+/* Retry interval while the gateway itself is not provisioned */
+#define DISCOVERY_RETRY_MS      5000
+
+/* GW_PATH_TTL_MARGIN in sensor_server_lps28. A scoped status arrives with
+ * one more than this left, or less if it came the long way round.
+ */
+#define DISCOVERY_PATH_MARGIN   1
+
+/* Sensor element masks are 32 bits wide */
+#define DISCOVERY_MAX_ELEMS     32
+
+enum phase {
+    PHASE_IDLE,
+    PHASE_COMP,         /* Composition Data Get sweep */
+    PHASE_COMP_SETTLE,
+    PHASE_GROUP,        /* Sensor Descriptor Get to the blind addresses */
+    PHASE_GROUP_SETTLE,
+    PHASE_DESC,         /* Sensor Descriptor Get sweep */
+    PHASE_DESC_SETTLE,
+};
+
+static struct bt_mesh_sensor_cli *sensor_cli;
+static struct k_work_delayable sweep_work;
+static struct k_spinlock lock;
+
+static enum phase phase;
+static uint16_t cursor;
+static bool (*keep_node)(uint16_t addr);
+static bool resweep;
+
+/* Table being built by the running sweep */
+static struct discovery_node scratch_nodes[DISCOVERY_MAX_NODES];
+static uint32_t scratch_elem_mask[DISCOVERY_MAX_NODES];  /* elements with a Sensor Server */
+static size_t scratch_node_count;
+static struct discovery_sensor scratch_sensors[DISCOVERY_MAX_SENSORS];
+static size_t scratch_sensor_count;
+
+/* Addresses Composition Data Get could not be sent to (no device key) */
+static uint32_t blind[DIV_ROUND_UP(DISCOVERY_ADDR_MAX + 1, 32)];
+
+/* First property served by each blind address that answered, 0 if none */
+static uint16_t first_prop[DISCOVERY_ADDR_MAX + 1];
+
+/* What the running sweep found but had no room for */
+static uint32_t nodes_dropped;
+static uint32_t sensors_dropped;
+
+/* Published node lists, double-buffered. A sweep publishes into the
+ * buffer that was not last handed out by discovery_nodes(), so the nodes a
+ * poll cycle was built from stay as they are until the poller takes the
+ * new ones. The sensors are only read while the poller builds its table,
+ * on the workqueue publish() runs on too, so one copy of them will do.
+ */
+static struct discovery_table {
+    struct discovery_node nodes[DISCOVERY_MAX_NODES];
+    size_t node_count;
+} tables[2];
+static uint8_t live;        /* latest published */
+static uint8_t in_use;      /* last handed out */
+static struct discovery_sensor sensors[DISCOVERY_MAX_SENSORS];
+static size_t sensor_count;
+static uint32_t generation;
+
+static void blind_set(uint16_t addr)
+{
+    blind[addr / 32] |= BIT(addr % 32);
+}
+
+static bool blind_test(uint16_t addr)
+{
+    return blind[addr / 32] & BIT(addr % 32);
+}
+
+/* Index of the node owning element addr, or -1. Call with lock held. */
+static int scratch_node_of(uint16_t addr)
+{
+    for (size_t n = 0; n < scratch_node_count; n++) {
+        if (addr >= scratch_nodes[n].addr &&
+            addr < scratch_nodes[n].addr + scratch_nodes[n].elem_count) {
+            return n;
+        }
+    }
+
+    return -1;
+}
+
+/* Add a node, or count it as dropped if the table is full. Call with lock held. */
+static void scratch_node_add(uint16_t addr, uint8_t elem_count, uint32_t mask)
+{
+    size_t n = scratch_node_count;
+
+    if (n == DISCOVERY_MAX_NODES) {
+        nodes_dropped++;
+        return;
+    }
+
+    scratch_nodes[n].addr = addr;
+    scratch_nodes[n].elem_count = elem_count;
+    scratch_nodes[n].hops = 0;
+    scratch_elem_mask[n] = mask;
+    scratch_node_count++;
+}
+
+static bool is_desc_target(uint16_t addr)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    int n = scratch_node_of(addr);
+    bool target = n >= 0 && (scratch_elem_mask[n] & BIT(addr - scratch_nodes[n].addr));
+
+    k_spin_unlock(&lock, key);
+    return target;
+}
+
+static void group_flush(uint16_t start, uint8_t len)
+{
+    /* The whole node is ours to poll or not, by its primary address */
+    if (len && (!keep_node || keep_node(start))) {
+        scratch_node_add(start, len, GENMASK(len - 1, 0));
+    }
+}
+
+/*
+ * Turn the blind addresses that answered into nodes. A node's elements
+ * have consecutive addresses and all of them answer, so a node ends at
+ * the first address that did not. Nodes provisioned back to back are
+ * told apart by their primary element: an element serving the same first
+ * property as the primary of the node being built starts the next node.
+ */
+static void group_blind(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint16_t start = 0;
+    uint8_t len = 0;
+
+    for (uint32_t addr = DISCOVERY_ADDR_MIN; addr <= DISCOVERY_ADDR_MAX; addr++) {
+        if (!first_prop[addr] || scratch_node_of(addr) >= 0) {
+            group_flush(start, len);
+            len = 0;
+        } else if (len && len < DISCOVERY_MAX_ELEMS && first_prop[addr] != first_prop[start]) {
+            len++;
+        } else {
+            group_flush(start, len);
+            start = addr;
+            len = 1;
+        }
+    }
+    group_flush(start, len);
+
+    k_spin_unlock(&lock, key);
+}
+
+/* Primary address of the node addr is an element of, if the gateway has
+ * its device key; 0 if it does not.
+ */
+static uint16_t keyed_primary(uint16_t addr)
+{
+#if defined(CONFIG_BT_MESH_CDB)
+    struct bt_mesh_cdb_node *node = bt_mesh_cdb_node_get(addr);
+
+    if (node) {
+        return node->addr;
+    }
+#endif
+    return 0;
+}
+
+static void probe_comp(uint16_t addr)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    bool known = scratch_node_of(addr) >= 0;
+    uint16_t primary;
+
+    k_spin_unlock(&lock, key);
+
+    /* Secondary element of a node we already have */
+    if (known) {
+        return;
+    }
+
+    primary = keyed_primary(addr);
+
+    /* Blind: the node is filtered once group_blind() has put it together */
+    if (!primary) {
+        blind_set(addr);
+        return;
+    }
+
+    /* Only the primary has a Config Server, and the node may not be ours */
+    if (addr != primary || (keep_node && !keep_node(addr))) {
+        return;
+    }
+
+    if (bt_mesh_cfg_cli_comp_data_get(0, addr, 0, NULL, NULL)) {
+        blind_set(addr);
+    }
+}
+
+static void probe_desc(uint16_t addr)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = 0,
+        .app_idx = 0,
+        .addr = addr,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+    int err;
+
+    err = bt_mesh_sensor_cli_desc_all_get(sensor_cli, &ctx, NULL, NULL);
+    if (err) {
+        printk("Descriptor Get to 0x%04x failed (err %d)\n", addr, err);
+    }
+}
+
+/* Insertion sorts, the tables are small and mostly in order already */
+static void sort_table(void)
+{
+    for (size_t i = 1; i < scratch_node_count; i++) {
+        struct discovery_node tmp = scratch_nodes[i];
+        size_t j = i;
+
+        while (j > 0 && scratch_nodes[j - 1].addr > tmp.addr) {
+            scratch_nodes[j] = scratch_nodes[j - 1];
+            j--;
+        }
+        scratch_nodes[j] = tmp;
+    }
+
+    for (size_t i = 1; i < scratch_sensor_count; i++) {
+        struct discovery_sensor tmp = scratch_sensors[i];
+        size_t j = i;
+
+        while (j > 0 && scratch_sensors[j - 1].addr > tmp.addr) {
+            scratch_sensors[j] = scratch_sensors[j - 1];
+            j--;
+        }
+        scratch_sensors[j] = tmp;
+    }
+
+    for (size_t i = 0; i < scratch_sensor_count; i++) {
+        scratch_sensors[i].node = scratch_node_of(scratch_sensors[i].addr);
+    }
+}
+
+static void publish(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    struct discovery_table *t = &tables[!in_use];
+    size_t used = 0;
+
+    sort_table();
+
+    /* Drop nodes that turned out to have no sensors */
+    for (size_t n = 0; n < scratch_node_count; n++) {
+        bool has_sensors = false;
+
+        for (size_t i = 0; i < scratch_sensor_count; i++) {
+            if (scratch_sensors[i].node == n) {
+                scratch_sensors[i].node = used;
+                has_sensors = true;
+            }
+        }
+
+        if (has_sensors) {
+            t->nodes[used++] = scratch_nodes[n];
+        }
+    }
+
+    t->node_count = used;
+    sensor_count = scratch_sensor_count;
+    memcpy(sensors, scratch_sensors, sensor_count * sizeof(sensors[0]));
+    live = !in_use;
+    generation++;
+
+    k_spin_unlock(&lock, key);
+
+    printk("Discovery done: %u nodes, %u sensors\n",
+           (unsigned)t->node_count, (unsigned)sensor_count);
+    if (nodes_dropped || sensors_dropped) {
+        printk("Discovery table full: %u nodes, %u sensors left out "
+               "(DISCOVERY_MAX_NODES %d, DISCOVERY_MAX_SENSORS %d)\n",
+               nodes_dropped, sensors_dropped, DISCOVERY_MAX_NODES, DISCOVERY_MAX_SENSORS);
+    }
+
+    settings_save_one("disc/nodes", t->nodes, t->node_count * sizeof(t->nodes[0]));
+    settings_save_one("disc/sensors", sensors, sensor_count * sizeof(sensors[0]));
+}
+
+static void sweep(struct k_work *work)
+{
+    switch (phase) {
+    case PHASE_IDLE:
+        /* Periodic refresh */
+        if (discovery_start() == -EAGAIN) {
+            k_work_schedule(&sweep_work, K_MSEC(DISCOVERY_RETRY_MS));
+        }
+        return;
+    case PHASE_COMP:
+        probe_comp(cursor);
+        if (cursor++ < DISCOVERY_ADDR_MAX) {
+            k_work_schedule(&sweep_work, K_MSEC(DISCOVERY_PROBE_MS));
+        } else {
+            phase = PHASE_COMP_SETTLE;
+            k_work_schedule(&sweep_work, K_MSEC(DISCOVERY_SETTLE_MS));
+        }
+        return;
+    case PHASE_COMP_SETTLE:
+        phase = PHASE_GROUP;
+        cursor = DISCOVERY_ADDR_MIN;
+        k_work_schedule(&sweep_work, K_NO_WAIT);
+        return;
+    case PHASE_GROUP:
+        while (cursor <= DISCOVERY_ADDR_MAX && !blind_test(cursor)) {
+            cursor++;
+        }
+        if (cursor <= DISCOVERY_ADDR_MAX) {
+            probe_desc(cursor++);
+            k_work_schedule(&sweep_work, K_MSEC(DISCOVERY_PROBE_MS));
+        } else {
+            phase = PHASE_GROUP_SETTLE;
+            k_work_schedule(&sweep_work, K_MSEC(DISCOVERY_SETTLE_MS));
+        }
+        return;
+    case PHASE_GROUP_SETTLE:
+        group_blind();
+        phase = PHASE_DESC;
+        cursor = DISCOVERY_ADDR_MIN;
+        k_work_schedule(&sweep_work, K_NO_WAIT);
+        return;
+    case PHASE_DESC:
+        /* Skip non-targets without waiting, only real probes are paced */
+        while (cursor <= DISCOVERY_ADDR_MAX && !is_desc_target(cursor)) {
+            cursor++;
+        }
+        if (cursor <= DISCOVERY_ADDR_MAX) {
+            probe_desc(cursor++);
+            k_work_schedule(&sweep_work, K_MSEC(DISCOVERY_PROBE_MS));
+        } else {
+            phase = PHASE_DESC_SETTLE;
+            k_work_schedule(&sweep_work, K_MSEC(DISCOVERY_SETTLE_MS));
+        }
+        return;
+    case PHASE_DESC_SETTLE:
+        publish();
+        phase = PHASE_IDLE;
+        if (resweep) {
+            resweep = false;
+            discovery_start();
+        } else {
+            k_work_schedule(&sweep_work, K_MSEC(DISCOVERY_REFRESH_MS));
+        }
+        return;
+    }
+}
+
+void discovery_init(struct bt_mesh_sensor_cli *cli)
+{
+    sensor_cli = cli;
+    k_work_init_delayable(&sweep_work, sweep);
+}
+
+void discovery_set_filter(bool (*keep)(uint16_t addr))
+{
+    keep_node = keep;
+}
+
+int discovery_start(void)
+{
+    if (phase != PHASE_IDLE) {
+        return -EBUSY;
+    }
+
+    if (!bt_mesh_is_provisioned()) {
+        return -EAGAIN;
+    }
+
+    scratch_node_count = 0;
+    scratch_sensor_count = 0;
+    memset(blind, 0, sizeof(blind));
+    memset(first_prop, 0, sizeof(first_prop));
+    nodes_dropped = 0;
+    sensors_dropped = 0;
+
+    printk("Discovering sensor servers in 0x%04x..0x%04x\n",
+           DISCOVERY_ADDR_MIN, DISCOVERY_ADDR_MAX);
+
+    cursor = DISCOVERY_ADDR_MIN;
+    phase = PHASE_COMP;
+    k_work_reschedule(&sweep_work, K_NO_WAIT);
+    return 0;
+}
+
+void discovery_refilter(void)
+{
+    if (discovery_start() == -EBUSY) {
+        resweep = true;
+    }
+}
+
+bool discovery_has_table(void)
+{
+    return generation != 0;
+}
+
+uint32_t discovery_generation(void)
+{
+    return generation;
+}
+
+uint8_t discovery_hops(uint8_t recv_ttl)
+{
+    if (recv_ttl <= DISCOVERY_PATH_MARGIN + 1 || recv_ttl > DISCOVERY_SERVER_TTL) {
+        return 0;
+    }
+
+    return DISCOVERY_SERVER_TTL - recv_ttl + 1;
+}
+
+size_t discovery_nodes(const struct discovery_node **out)
+{
+    in_use = live;
+    *out = tables[live].nodes;
+    return tables[live].node_count;
+}
+
+size_t discovery_sensors(const struct discovery_sensor **out)
+{
+    in_use = live;
+    *out = sensors;
+    return sensor_count;
+}
+
+void discovery_comp_data(uint16_t addr, uint8_t page, struct net_buf_simple *buf)
+{
+    struct bt_mesh_comp_p0 comp;
+    struct bt_mesh_comp_p0_elem elem;
+    uint32_t mask = 0;
+    uint8_t elem_count = 0;
+    k_spinlock_key_t key;
+
+    if (page != 0 || (phase != PHASE_COMP && phase != PHASE_COMP_SETTLE)) {
+        return;
+    }
+
+    if (bt_mesh_comp_p0_get(&comp, buf)) {
+        printk("Bad composition data from 0x%04x\n", addr);
+        return;
+    }
+
+    while (bt_mesh_comp_p0_elem_pull(&comp, &elem) && elem_count < DISCOVERY_MAX_ELEMS) {
+        for (int i = 0; i < elem.nsig; i++) {
+            if (bt_mesh_comp_p0_elem_mod(&elem, i) == BT_MESH_MODEL_ID_SENSOR_SRV) {
+                mask |= BIT(elem_count);
+                break;
+            }
+        }
+        elem_count++;
+    }
+
+    printk("Node 0x%04x: %u elements, sensor elements 0x%08x\n", addr, elem_count, mask);
+
+    if (!mask) {
+        return;
+    }
+
+    key = k_spin_lock(&lock);
+    if (scratch_node_of(addr) < 0) {
+        scratch_node_add(addr, elem_count, mask);
+    }
+    k_spin_unlock(&lock, key);
+}
+
+void discovery_sensor_desc(struct bt_mesh_msg_ctx *ctx, const struct bt_mesh_sensor_info *info)
+{
+    k_spinlock_key_t key;
+    uint8_t hops;
+    int node;
+
+    if (phase == PHASE_GROUP || phase == PHASE_GROUP_SETTLE) {
+        /* Only which addresses answer, and with what, for group_blind() */
+        key = k_spin_lock(&lock);
+        if (ctx->addr <= DISCOVERY_ADDR_MAX && blind_test(ctx->addr) &&
+            !first_prop[ctx->addr]) {
+            first_prop[ctx->addr] = info->id;
+        }
+        k_spin_unlock(&lock, key);
+        return;
+    }
+
+    if (phase != PHASE_DESC && phase != PHASE_DESC_SETTLE) {
+        return;
+    }
+
+    /* Without a type the client cannot decode the values */
+    if (!bt_mesh_sensor_type_get(info->id)) {
+        printk("0x%04x: unknown sensor type 0x%04x, skipped\n", ctx->addr, info->id);
+        return;
+    }
+
+    key = k_spin_lock(&lock);
+
+    node = scratch_node_of(ctx->addr);
+    if (node < 0) {
+        /* Not an element of a node in the table */
+        goto unlock;
+    }
+
+    /* Every element answers on its own, keep the shortest */
+    hops = discovery_hops(ctx->recv_ttl);
+    if (hops && (!scratch_nodes[node].hops || hops < scratch_nodes[node].hops)) {
+        scratch_nodes[node].hops = hops;
+    }
+
+    for (size_t i = 0; i < scratch_sensor_count; i++) {
+        if (scratch_sensors[i].addr == ctx->addr && scratch_sensors[i].prop_id == info->id) {
+            goto unlock;
+        }
+    }
+
+    if (scratch_sensor_count < DISCOVERY_MAX_SENSORS) {
+        scratch_sensors[scratch_sensor_count].addr = ctx->addr;
+        scratch_sensors[scratch_sensor_count].prop_id = info->id;
+        scratch_sensors[scratch_sensor_count].node = node;
+        scratch_sensor_count++;
+    } else {
+        sensors_dropped++;
+    }
+
+unlock:
+    k_spin_unlock(&lock, key);
+}
+
+static int disc_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+                             void *cb_arg)
+{
+    struct discovery_table *t = &tables[live];
+    const char *next;
+    ssize_t rc;
+
+    if (settings_name_steq(name, "nodes", &next) && !next) {
+        if (len > sizeof(t->nodes) || len % sizeof(t->nodes[0])) {
+            return -EINVAL;
+        }
+        rc = read_cb(cb_arg, t->nodes, len);
+        if (rc < 0) {
+            return rc;
+        }
+        t->node_count = len / sizeof(t->nodes[0]);
+        return 0;
+    }
+
+    if (settings_name_steq(name, "sensors", &next) && !next) {
+        if (len > sizeof(sensors) || len % sizeof(sensors[0])) {
+            return -EINVAL;
+        }
+        rc = read_cb(cb_arg, sensors, len);
+        if (rc < 0) {
+            return rc;
+        }
+        sensor_count = len / sizeof(sensors[0]);
+        return 0;
+    }
+
+    return -ENOENT;
+}
+
+static int disc_settings_commit(void)
+{
+    struct discovery_table *t = &tables[live];
+
+    for (size_t i = 0; i < sensor_count; i++) {
+        if (sensors[i].node >= t->node_count) {
+            /* Half-written table, rediscover */
+            t->node_count = 0;
+            sensor_count = 0;
+            return 0;
+        }
+    }
+
+    if (sensor_count) {
+        generation++;
+        printk("Restored %u nodes, %u sensors\n",
+               (unsigned)t->node_count, (unsigned)sensor_count);
+        k_work_schedule(&sweep_work, K_MSEC(DISCOVERY_REFRESH_MS));
+    }
+
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(disc, "disc", NULL, disc_settings_set, disc_settings_commit, NULL);
@@ -0,0 +1,99 @@
+#include "dispatch.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+/*
+ * Keys pack (addr << 16 | prop_id). Address 0x0000 is the unassigned
+ * address and never appears on a status, so key 0 marks an empty slot
+ * and a zeroed table is empty.
+ */
+#define KEY_EMPTY 0U
+
+static uint32_t keys[DISPATCH_SLOTS];
+static uint16_t vals[DISPATCH_SLOTS];
+static uint32_t count;
+static uint32_t probes;
+
+static inline uint32_t make_key(uint16_t addr, uint16_t prop_id)
+{
+    return ((uint32_t)addr << 16) | prop_id;
+}
+
+/* Fibonacci hashing: the top bits of key * 2^32/phi */
+static inline uint32_t slot_of(uint32_t key)
+{
+    return (key * 2654435769U) >> (32 - DISPATCH_SLOTS_LOG2);
+}
+
+void dispatch_reset(void)
+{
+    memset(keys, 0, sizeof(keys));
+    count = 0;
+    probes = 0;
+}
+
+int dispatch_add(uint16_t addr, uint16_t prop_id, uint16_t idx)
+{
+    uint32_t key = make_key(addr, prop_id);
+    uint32_t slot = slot_of(key);
+
+    if (addr == 0) {
+        return -EINVAL;
+    }
+
+    for (uint32_t n = 0; n < DISPATCH_SLOTS; n++) {
+        if (keys[slot] == KEY_EMPTY) {
+            keys[slot] = key;
+            vals[slot] = idx;
+            count++;
+            return 0;
+        }
+
+        if (keys[slot] == key) {
+            vals[slot] = idx;
+            return 0;
+        }
+
+        slot = (slot + 1) & (DISPATCH_SLOTS - 1);
+    }
+
+    return -ENOMEM;
+}
+
+int dispatch_find(uint16_t addr, uint16_t prop_id)
+{
+    uint32_t key = make_key(addr, prop_id);
+    uint32_t slot = slot_of(key);
+
+    if (addr == 0) {
+        return -ENOENT;
+    }
+
+    /* A miss ends at the first empty slot; the bound covers a full table */
+    for (uint32_t n = 0; n < DISPATCH_SLOTS; n++) {
+        probes++;
+
+        if (keys[slot] == key) {
+            return vals[slot];
+        }
+
+        if (keys[slot] == KEY_EMPTY) {
+            break;
+        }
+
+        slot = (slot + 1) & (DISPATCH_SLOTS - 1);
+    }
+
+    return -ENOENT;
+}
+
+uint32_t dispatch_count(void)
+{
+    return count;
+}
+
+uint32_t dispatch_probes(void)
+{
+    return probes;
+}
@@ -0,0 +1,172 @@
+#include "frame.h"
+#include "uart_out.h"
+#include "history.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+#define FRAME_CRC_SIZE 2
+
+/* Keeps the sequence numbers in the order the frames are queued in */
+static K_MUTEX_DEFINE(tx_lock);
+static uint16_t seq;
+
+void frame_begin(struct frame *frame, uint8_t type, uint32_t timestamp_ms)
+{
+    frame->len = 0;
+    frame->overflow = false;
+
+    frame_put_u8(frame, FRAME_VERSION);
+    frame_put_u8(frame, type);
+    frame_put_le16(frame, 0);   /* seq, filled in on send */
+    frame_put_le32(frame, timestamp_ms);
+}
+
+size_t frame_room(const struct frame *frame)
+{
+    return FRAME_MAX - FRAME_CRC_SIZE - frame->len;
+}
+
+void frame_put_bytes(struct frame *frame, const void *data, size_t len)
+{
+    if (frame->overflow || len > frame_room(frame)) {
+        frame->overflow = true;
+        return;
+    }
+
+    memcpy(&frame->buf[frame->len], data, len);
+    frame->len += len;
+}
+
+void frame_put_u8(struct frame *frame, uint8_t val)
+{
+    frame_put_bytes(frame, &val, sizeof(val));
+}
+
+void frame_put_le16(struct frame *frame, uint16_t val)
+{
+    uint8_t le[2];
+
+    sys_put_le16(val, le);
+    frame_put_bytes(frame, le, sizeof(le));
+}
+
+void frame_put_le32(struct frame *frame, uint32_t val)
+{
+    uint8_t le[4];
+
+    sys_put_le32(val, le);
+    frame_put_bytes(frame, le, sizeof(le));
+}
+
+size_t frame_cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t code_pos = 0;
+    size_t out_len = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i]) {
+            out[out_len++] = in[i];
+            code++;
+        }
+
+        /* A zero ends the block, as does a full block of 254 bytes. A
+         * full block at the very end is the last one: it stands for no
+         * zero, so no empty block has to follow it.
+         */
+        if (!in[i] || (code == 0xFF && i + 1 < len)) {
+            out[code_pos] = code;
+            code_pos = out_len++;
+            code = 1;
+        }
+    }
+
+    out[code_pos] = code;
+    return out_len;
+}
+
+int frame_cobs_decode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t out_len = 0;
+    size_t pos = 0;
+
+    while (pos < len) {
+        uint8_t code = in[pos++];
+
+        if (!code || pos + code - 1 > len) {
+            return -EBADMSG;
+        }
+
+        memmove(&out[out_len], &in[pos], code - 1);
+        out_len += code - 1;
+        pos += code - 1;
+
+        /* A short block stands for a zero, except at the very end */
+        if (code < 0xFF && pos < len) {
+            out[out_len++] = 0x00;
+        }
+    }
+
+    return out_len;
+}
+
+int frame_check(const uint8_t *buf, size_t len)
+{
+    if (len < FRAME_HDR_SIZE + FRAME_CRC_SIZE || buf[0] != FRAME_VERSION) {
+        return -EBADMSG;
+    }
+
+    len -= FRAME_CRC_SIZE;
+    if (crc16_ccitt(0xFFFF, buf, len) != sys_get_le16(&buf[len])) {
+        return -EBADMSG;
+    }
+
+    return len;
+}
+
+int frame_write(const uint8_t *buf, size_t len)
+{
+    /* Delimiter, COBS output, delimiter */
+    uint8_t out[1 + FRAME_MAX + FRAME_MAX / 254 + 1 + 1];
+    size_t out_len;
+
+    if (len > FRAME_MAX) {
+        return -ENOSPC;
+    }
+
+    /* Leading delimiter too, it cuts the frame off from any printk text
+     * that did not end in a newline.
+     */
+    out[0] = 0x00;
+    out_len = 1 + frame_cobs_encode(buf, len, &out[1]);
+    out[out_len++] = 0x00;
+
+    return uart_out_write(out, out_len);
+}
+
+int frame_send(struct frame *frame)
+{
+    int err;
+
+    if (frame->overflow) {
+        return -ENOSPC;
+    }
+
+    k_mutex_lock(&tx_lock, K_FOREVER);
+
+    sys_put_le16(seq++, &frame->buf[2]);
+    sys_put_le16(crc16_ccitt(0xFFFF, frame->buf, frame->len), &frame->buf[frame->len]);
+    frame->len += FRAME_CRC_SIZE;
+
+    /* Kept even if the UART drops it, so the host can ask for it again */
+    history_add(frame->buf, frame->len);
+
+    /* A dropped frame shows up as a gap in seq on the host */
+    err = frame_write(frame->buf, frame->len);
+
+    k_mutex_unlock(&tx_lock);
+    return err;
+}
@@ -0,0 +1,133 @@
+#include "history.h"
+#include "frame.h"
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+BUILD_ASSERT(IS_POWER_OF_TWO(HISTORY_SIZE), "positions wrap with the ring");
+
+/* Retry interval while the UART ring is full */
+#define REPLAY_RETRY_MS 20
+
+/* Entries are a length byte followed by the frame, back to back in a byte
+ * ring. Positions count bytes since boot, so comparing a position with
+ * tail tells whether its entry has been overwritten.
+ */
+static uint8_t ring[HISTORY_SIZE];
+static uint32_t head;       /* where the next entry goes */
+static uint32_t tail;       /* oldest entry still held */
+static struct k_spinlock lock;
+
+/* Replay progress; only touched from the system workqueue */
+static uint32_t replay_pos;
+static uint32_t replay_end;
+
+static void replay_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(replay_work, replay_handler);
+
+static inline uint8_t byte_at(uint32_t pos)
+{
+    return ring[pos % HISTORY_SIZE];
+}
+
+static inline uint32_t next_entry(uint32_t pos)
+{
+    return pos + 1 + byte_at(pos);
+}
+
+/* The seq field of the frame at pos, see frame.h */
+static uint16_t entry_seq(uint32_t pos)
+{
+    return byte_at(pos + 1 + 2) | (byte_at(pos + 1 + 3) << 8);
+}
+
+void history_add(const uint8_t *frame, size_t len)
+{
+    k_spinlock_key_t key;
+
+    if (len > UINT8_MAX) {
+        return;
+    }
+
+    key = k_spin_lock(&lock);
+
+    /* Push out the oldest entries until this one fits */
+    while (head - tail + 1 + len > HISTORY_SIZE) {
+        tail = next_entry(tail);
+    }
+
+    ring[head % HISTORY_SIZE] = len;
+    for (size_t i = 0; i < len; i++) {
+        ring[(head + 1 + i) % HISTORY_SIZE] = frame[i];
+    }
+    head += 1 + len;
+
+    k_spin_unlock(&lock, key);
+}
+
+int history_resume(uint16_t seq)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t from = tail;
+    bool found = false;
+    int count = 0;
+
+    for (uint32_t pos = tail; pos != head; pos = next_entry(pos)) {
+        if (entry_seq(pos) == seq) {
+            from = next_entry(pos);
+            found = true;
+            break;
+        }
+    }
+
+    for (uint32_t pos = from; pos != head; pos = next_entry(pos)) {
+        count++;
+    }
+
+    replay_pos = from;
+    replay_end = head;
+
+    k_spin_unlock(&lock, key);
+
+    printk("RESUME %u: %s, replaying %d frames\n",
+           seq, found ? "held" : "not held", count);
+
+    k_work_reschedule(&replay_work, K_NO_WAIT);
+    return count;
+}
+
+static void replay_handler(struct k_work *work)
+{
+    uint8_t frame[FRAME_MAX];
+    k_spinlock_key_t key;
+    size_t len;
+
+    for (;;) {
+        key = k_spin_lock(&lock);
+
+        /* Frames pushed out while waiting for the UART are gone */
+        if ((int32_t)(replay_pos - tail) < 0) {
+            replay_pos = tail;
+        }
+        if ((int32_t)(replay_end - replay_pos) <= 0) {
+            k_spin_unlock(&lock, key);
+            return;
+        }
+
+        len = byte_at(replay_pos);
+        for (size_t i = 0; i < len; i++) {
+            frame[i] = byte_at(replay_pos + 1 + i);
+        }
+
+        k_spin_unlock(&lock, key);
+
+        if (frame_write(frame, len) == -ENOBUFS) {
+            /* At full UART speed, the ring drains while we wait */
+            k_work_schedule(&replay_work, K_MSEC(REPLAY_RETRY_MS));
+            return;
+        }
+
+        replay_pos += 1 + len;
+    }
+}
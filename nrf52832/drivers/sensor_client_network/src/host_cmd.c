@@ -0,0 +1,212 @@
+#include "host_cmd.h"
+#include "frame.h"
+#include "history.h"
+#include "poll_plan.h"
+#include "shard.h"
+#include "series.h"
+#include "uart_out.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+#define HOST_CMD_MAX_ARGS 8
+
+struct host_cmd {
+    const char *name;
+    const char *usage;
+    int (*handler)(int argc, char **argv);
+};
+
+static int parse_u32(const char *str, uint32_t *val)
+{
+    char *end;
+
+    *val = strtoul(str, &end, 0);
+    return (*str && !*end) ? 0 : -EINVAL;
+}
+
+static int cmd_resume(int argc, char **argv)
+{
+    uint32_t seq;
+
+    if (argc != 2 || parse_u32(argv[1], &seq) || seq > UINT16_MAX) {
+        return -EINVAL;
+    }
+
+    history_resume(seq);
+    return 0;
+}
+
+static int cmd_plan(int argc, char **argv)
+{
+    if (argc == 2 && !strcmp(argv[1], "RESET")) {
+        poll_plan_reset();
+    } else if (argc != 1) {
+        return -EINVAL;
+    }
+
+    poll_plan_print(poll_plan_get());
+    return 0;
+}
+
+static int parse_float(const char *str, float *val)
+{
+    char *end;
+
+    *val = strtof(str, &end);
+    return (*str && !*end) ? 0 : -EINVAL;
+}
+
+/* Columns in the units of the series' column channel, e.g. degrees */
+static int cmd_series(int argc, char **argv)
+{
+    const struct bt_mesh_sensor_type *type;
+    struct bt_mesh_sensor_column range;
+    uint32_t addr, prop_id;
+    float start, width;
+    int err;
+
+    if ((argc != 3 && argc != 5) ||
+        parse_u32(argv[1], &addr) || !BT_MESH_ADDR_IS_UNICAST(addr) ||
+        parse_u32(argv[2], &prop_id) || prop_id > UINT16_MAX) {
+        return -EINVAL;
+    }
+
+    type = bt_mesh_sensor_type_get(prop_id);
+    if (!type || type->channel_count < 2) {
+        return -ENOENT;
+    }
+
+    if (argc == 3) {
+        return series_fetch(addr, type, NULL);
+    }
+
+    if (parse_float(argv[3], &start) || parse_float(argv[4], &width)) {
+        return -EINVAL;
+    }
+
+    err = bt_mesh_sensor_value_from_float(type->channels[1].format, start, &range.start);
+    if (!err) {
+        err = bt_mesh_sensor_value_from_float(type->channels[1].format, width, &range.width);
+    }
+    if (err) {
+        return err;
+    }
+
+    return series_fetch(addr, type, &range);
+}
+
+static int cmd_shard(int argc, char **argv)
+{
+    if (argc != 1) {
+        return -EINVAL;
+    }
+
+    shard_print();
+    return 0;
+}
+
+static const struct host_cmd cmds[] = {
+    { .name = "RESUME", .usage = "RESUME <seq>", .handler = cmd_resume },
+    { .name = "PLAN",   .usage = "PLAN [RESET]", .handler = cmd_plan },
+    { .name = "SHARD",  .usage = "SHARD",        .handler = cmd_shard },
+    { .name = "SERIES", .usage = "SERIES <addr> <prop_id> [<start> <width>]",
+      .handler = cmd_series },
+};
+
+/* Binary commands, by FRAME_TYPE_* */
+struct host_frame_cmd {
+    uint8_t type;
+    const char *name;
+    int (*handler)(const uint8_t *payload, size_t len);
+};
+
+static const struct host_frame_cmd frame_cmds[] = {
+    { .type = FRAME_TYPE_PLAN, .name = "PLAN", .handler = poll_plan_set },
+};
+
+/* Runs on the system workqueue, see uart_out.h */
+static void host_cmd_frame(uint8_t *buf, size_t len)
+{
+    /* Decoding never grows the frame, so it can be done in place */
+    int frame_len = frame_cobs_decode(buf, len, buf);
+    uint16_t seq;
+
+    if (frame_len >= 0) {
+        frame_len = frame_check(buf, frame_len);
+    }
+    if (frame_len < 0) {
+        printk("ERR bad frame (err %d)\n", frame_len);
+        return;
+    }
+
+    seq = sys_get_le16(&buf[2]);
+
+    for (size_t i = 0; i < ARRAY_SIZE(frame_cmds); i++) {
+        int err;
+
+        if (buf[1] != frame_cmds[i].type) {
+            continue;
+        }
+
+        err = frame_cmds[i].handler(&buf[FRAME_HDR_SIZE], frame_len - FRAME_HDR_SIZE);
+        if (err) {
+            printk("ERR %s %u (err %d)\n", frame_cmds[i].name, seq, err);
+        } else {
+            printk("%s %u ok\n", frame_cmds[i].name, seq);
+        }
+        return;
+    }
+
+    printk("ERR unknown frame type 0x%02X\n", buf[1]);
+}
+
+/* Runs on the system workqueue, see uart_out.h */
+static void host_cmd_line(char *line)
+{
+    char *argv[HOST_CMD_MAX_ARGS];
+    int argc = 0;
+    char *p = line;
+
+    while (*p && argc < ARRAY_SIZE(argv)) {
+        while (*p == ' ') {
+            *p++ = '\0';
+        }
+        if (!*p) {
+            break;
+        }
+        argv[argc++] = p;
+        while (*p && *p != ' ') {
+            p++;
+        }
+    }
+
+    if (!argc) {
+        return;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(cmds); i++) {
+        int err;
+
+        if (strcmp(argv[0], cmds[i].name)) {
+            continue;
+        }
+
+        err = cmds[i].handler(argc, argv);
+        if (err) {
+            printk("ERR %s (err %d), usage: %s\n", argv[0], err, cmds[i].usage);
+        }
+        return;
+    }
+
+    printk("ERR unknown command %s\n", argv[0]);
+}
+
+int host_cmd_init(void)
+{
+    return uart_out_rx_start(host_cmd_line, host_cmd_frame);
+}
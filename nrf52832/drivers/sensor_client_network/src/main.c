@@ -12,10 +12,17 @@
 #include <bluetooth/mesh/dk_prov.h>
 #include <dk_buttons_and_leds.h>
 #include "model_handler.h"
+#if defined(CONFIG_BOARD_NRF52_BSIM)
+#include "sim_prov.h"
+#endif
+#include "uart_out.h"
+#include "host_cmd.h"
 
 
 static void bt_ready(int err)
 {
+	const struct bt_mesh_comp *comp;
+
 	if (err) {
 		printk("Bluetooth init failed (err %d)\n", err);
 		return;
@@ -35,7 +42,8 @@ static void bt_ready(int err)
 		return;
 	}
 
-	err = bt_mesh_init(bt_mesh_dk_prov_init(), model_handler_init());
+	comp = model_handler_init();
+	err = bt_mesh_init(bt_mesh_dk_prov_init(), comp);
 	if (err) {
 		printk("Initializing mesh failed (err %d)\n", err);
 		return;
@@ -45,6 +53,14 @@ static void bt_ready(int err)
 		settings_load();
 	}
 
+#if defined(CONFIG_BOARD_NRF52_BSIM)
+	/* No phone in the simulator, see nrf52832/drivers/mesh_bsim */
+	err = sim_prov_start(comp);
+	if (err) {
+		printk("Simulated provisioning failed (err %d)\n", err);
+	}
+#endif
+
 	/* This will be a no-op if settings_load() loaded provisioning info */
 	bt_mesh_prov_enable(BT_MESH_PROV_ADV | BT_MESH_PROV_GATT);
 
@@ -55,6 +71,17 @@ int main(void)
 {
 	int err;
 
+	/* Before anything else prints, so all output goes through the ring */
+	err = uart_out_init();
+	if (err) {
+		printk("Async UART output not available (err %d)\n", err);
+	} else {
+		err = host_cmd_init();
+		if (err) {
+			printk("Host commands not available (err %d)\n", err);
+		}
+	}
+
 	printk("Initializing...\n");
 
 	err = bt_enable(bt_ready);
@@ -8,72 +8,612 @@
 #include <bluetooth/mesh/models.h>
 #include <dk_buttons_and_leds.h>
 #include "model_handler.h"
+#include "dispatch.h"
+#include "discovery.h"
+#include "sched.h"
+#include "rtt_hist.h"
+#include "frame.h"
+#include "uart_out.h"
+#include "poll_plan.h"
+#include "shard.h"
+#include "series.h"
+#include <stdarg.h>
+#include <zephyr/shell/shell.h>
 #include <bluetooth/mesh/sensor_types.h>
 
 #define GET_DATA_INTERVAL	1000
-#define GET_DATA_INTERVAL_QUICK 500
 #define MOTION_TIMEOUT		K_SECONDS(60)
 
 /* Replace these with your actual NetKey/AppKey indices and TTL */
 #define NET_IDX            0
 #define APP_IDX            0
+/* Servers recover their hop distance from this TTL (GW_PATH_REQUEST_TTL in
+ * sensor_server_lps28), so keep the two in sync.
+ */
 #define DEFAULT_TTL        7
 
-static const uint16_t server_addrs[] = { 0x0037, 0x003F /*, … */ };
+/* Group the Sensor Server models of every lysimeter node subscribe to. Set
+ * up by the provisioner, e.g. a "Lysimeters" group in the nRF Mesh app.
+ */
+#define POLL_GROUP_ADDR    0xC010
+
+/* How a cycle asks for data:
+ * POLL_UNICAST   one GET per sensor per server
+ * POLL_MULTICAST one GET per property to POLL_GROUP_ADDR, every server
+ *                answers after a random delay of up to 500 ms (see the
+ *                server prj.conf)
+ * POLL_ELEMENT   one property-less GET per element, which returns every
+ *                sensor the element has in one status. Which elements to
+ *                ask comes from the descriptors cached by discovery.
+ * POLL_ALTERNATE switch every cycle, to compare loss of the modes
+ */
+#define POLL_UNICAST       0
+#define POLL_MULTICAST     1
+#define POLL_ELEMENT       2
+#define POLL_MODES         3
+#define POLL_ALTERNATE     POLL_MODES
+#define POLL_MODE          POLL_ELEMENT
+
+/* How readings go out on the UART:
+ * OUTPUT_TEXT   a CSV header and row per server, values as %.2f
+ * OUTPUT_BINARY one COBS framed record per server with the raw mesh
+ *               encoded values, and the path statistics, see frame.h
+ * The LOSS/SCHED/RTT diagnostics stay text either way.
+ */
+#define OUTPUT_TEXT        0
+#define OUTPUT_BINARY      1
+#define OUTPUT_FORMAT      OUTPUT_BINARY
+
+/* A text line per GET and per status, and the PATH lines. In binary mode
+ * the frames carry all of it, so it is left off the UART they share.
+ * Without the async UART (BabbleSim) no frames go out, and analyze.py
+ * works from the text.
+ */
+#define OUTPUT_TRACE       (OUTPUT_FORMAT == OUTPUT_TEXT || !IS_ENABLED(CONFIG_UART_ASYNC_API))
+
+/* Where readings come from:
+ * INGEST_POLL    the gateway asks for them, as set by POLL_MODE
+ * INGEST_PASSIVE the gateway sends no GETs. The servers' Sensor Servers
+ *                publish to PUB_GROUP_ADDR with a period of their own,
+ *                the Sensor Client is subscribed to it, and each status
+ *                is forwarded as soon as it is in.
+ * Discovery runs either way, its sweep is the only request traffic left
+ * in passive mode. Both subscription and publication are set up by the
+ * provisioner.
+ */
+#define INGEST_POLL        0
+#define INGEST_PASSIVE     1
+#ifndef INGEST_MODE
+#define INGEST_MODE        INGEST_POLL
+#endif
+
+#define PUB_GROUP_ADDR     0xC012
+
+/* A status with the same value for the same record within this time is a
+ * retransmission of a publication, not a new reading. The access layer
+ * does not hand up the network sequence number, and a retransmission has
+ * a sequence number of its own anyway; relayed copies of one packet are
+ * already dropped by the network cache. Keep the publish periods well
+ * above this.
+ */
+#define PASSIVE_DEDUP_MS   1000
+
+/* Passive mode prints its counters and judges liveness this often */
+#define PASSIVE_REPORT_MS  60000
+
+/* Lysimeter mass (HX711) served by sensor_server_lps28. The property ID is
+ * not SIG-assigned, so the type has to be registered here for the sensor
+ * client to decode it. Keep in sync with LYSIMETER_PROP_ID_MASS on the server.
+ * Each load cell is on an element of its own (offset 7 + n); discovery
+ * finds those like any other Sensor Server element.
+ */
+#define LYSIMETER_PROP_ID_MASS 0x7F01
+
+const STRUCT_SECTION_ITERABLE(bt_mesh_sensor_type, lysimeter_mass) = {
+    .id = LYSIMETER_PROP_ID_MASS,
+    .channels = (const struct bt_mesh_sensor_channel[]) {
+        { .format = &bt_mesh_sensor_format_float32 },
+    },
+    .channel_count = 1,
+};
+
+/* Poll classes, the built-in periods. A server's sensors of one period are
+ * polled together; each (server, period) pair is an entry in the deadline
+ * scheduler. The poll plan can move properties to periods of their own.
+ */
+#define CLASS_FAST         0
+#define CLASS_NORMAL       1
+#define CLASS_SLOW         2
+#define POLL_CLASSES       3
 
 typedef struct {
-    uint8_t                           elem_offset;    /* 0 = primary, 1 = Element 1, … */
+    const char *name;
+    uint32_t    period_ms;
+} poll_class_t;
+
+static const poll_class_t poll_classes[POLL_CLASSES] = {
+    [CLASS_FAST]   = { .name = "fast",   .period_ms = 5000   },
+    [CLASS_NORMAL] = { .name = "normal", .period_ms = 30000  },
+    [CLASS_SLOW]   = { .name = "slow",   .period_ms = 300000 },
+};
+
+/* Column labels and poll classes for the sensor types we know; anything else
+ * discovery finds is labelled with its property ID and polled as CLASS_NORMAL.
+ * Both apply unless the poll plan says otherwise.
+ */
+typedef struct {
     const struct bt_mesh_sensor_type *type;
     const char                       *name;
-} sensor_def_t;
-
-static const sensor_def_t sensor_defs[] = {
-    { .elem_offset = 0, .type = &bt_mesh_sensor_present_amb_light_level,        .name = "Ambient Light"       },
-    { .elem_offset = 1, .type = &bt_mesh_sensor_presence_detected,              .name = "Time Since Presenc"  },
-    { .elem_offset = 2, .type = &bt_mesh_sensor_time_since_motion_sensed,       .name = "Time Since Motion"   },
-    { .elem_offset = 3, .type = &bt_mesh_sensor_people_count,                   .name = "People Count"        },
-    { .elem_offset = 4, .type = &bt_mesh_sensor_present_dev_op_temp,            .name = "Chip Temp"           },
-    { .elem_offset = 5, .type = &bt_mesh_sensor_present_amb_temp,               .name = "Sensor Temp"         },
-    { .elem_offset = 6, .type = &bt_mesh_sensor_pressure,                       .name = "Pressure"            },
+    uint8_t                           class;
+} sensor_label_t;
+
+static const sensor_label_t sensor_labels[] = {
+    { .type = &bt_mesh_sensor_present_amb_light_level,        .name = "Ambient Light",      .class = CLASS_NORMAL },
+    { .type = &bt_mesh_sensor_presence_detected,              .name = "Time Since Presenc", .class = CLASS_NORMAL },
+    { .type = &bt_mesh_sensor_time_since_motion_sensed,       .name = "Time Since Motion",  .class = CLASS_NORMAL },
+    { .type = &bt_mesh_sensor_people_count,                   .name = "People Count",       .class = CLASS_NORMAL },
+    { .type = &bt_mesh_sensor_present_dev_op_temp,            .name = "Chip Temp",          .class = CLASS_SLOW   },
+    { .type = &bt_mesh_sensor_present_amb_temp,               .name = "Sensor Temp",        .class = CLASS_NORMAL },
+    { .type = &bt_mesh_sensor_pressure,                       .name = "Pressure",           .class = CLASS_FAST   },
+    { .type = &lysimeter_mass,                                .name = "Mass",               .class = CLASS_FAST   },
 };
 
-/* total sensors = servers × types */
-#define SENSOR_COUNT  (ARRAY_SIZE(server_addrs) * ARRAY_SIZE(sensor_defs))
+/* Records are built from the discovered table, see load_sensor_table() */
+#define MAX_RECORDS   DISCOVERY_MAX_SENSORS
+#define MAX_SERVERS   DISCOVERY_MAX_NODES
+#define MAX_TYPES     32
+
+/* How long a single GET may stay unanswered before its slot is reused,
+ * unless the poll plan says otherwise
+ */
+#define REQUEST_TIMEOUT_MS 2000
+
+/* Servers answer a group-addressed GET after a random 20-500 ms, a unicast
+ * one after 20-50 ms (see the server prj.conf). Where the cycle sends group
+ * GETs, no timeout is set below the longest delay plus some time for the
+ * path.
+ */
+#define GROUP_RESPONSE_DELAY_MS 500
+#define GROUP_TIMEOUT_MIN_MS    (GROUP_RESPONSE_DELAY_MS + 500)
 
-/* Your table to store values + valid flags + name strings */
+/* Poll groups, the periods records are polled at: the poll classes first,
+ * then one for each other period in the poll plan.
+ */
+#define MAX_GROUPS    (POLL_CLASSES + POLL_PLAN_MAX_PROPS)
+
+static uint32_t group_period[MAX_GROUPS];
+static size_t   group_count;
+
+/* Where a record is in the current polling cycle */
+typedef enum {
+    REQ_QUEUED,     /* GET not sent yet */
+    REQ_PENDING,    /* GET sent, waiting for the status */
+    REQ_DONE,       /* status received */
+    REQ_TIMEOUT,    /* no status within timeout_ms */
+    REQ_FAILED,     /* GET could not be sent */
+    REQ_RETRY,      /* timed out, waiting for retry_at to ask again */
+    REQ_SKIPPED,    /* server is down, not asked this cycle */
+    REQ_IDLE,       /* poll class not due this cycle */
+} req_state_t;
+
+/* Distinct sensor types in sensor_table, one group GET each */
+static const struct bt_mesh_sensor_type *poll_types[MAX_TYPES];
+static size_t                            poll_type_count;
+
+/* Largest encoded value kept per record, first channel only */
+#define REC_RAW_MAX   sizeof(((struct bt_mesh_sensor_value *)0)->raw)
+
+/* The records, one per (element, property), as a struct of arrays, so the
+ * loops over one field run through contiguous memory and no record pays
+ * for padding. What can be derived is not stored: the GET context comes
+ * from addr (rec_ctx()), the type from poll_types[], the label from the
+ * type, the value's format from the type's first channel.
+ *
+ * A record's value is from the current cycle if its gen stamp is
+ * cycle_gen. Starting a cycle bumps cycle_gen instead of clearing a flag
+ * in every record; gen 0 means no value at all.
+ */
 typedef struct {
-    const char                        *name;
-    struct bt_mesh_msg_ctx            ctx;
-    const struct bt_mesh_sensor_type *type;
-    struct bt_mesh_sensor_value       value;
-    bool                              valid;
-} sensor_record_t;
+    uint16_t addr[MAX_RECORDS];                 /* element */
+    uint8_t  type[MAX_RECORDS];                 /* index into poll_types[] */
+    uint8_t  server[MAX_RECORDS];               /* index into servers[] */
+    uint8_t  group[MAX_RECORDS];                /* index into group_period[] */
+    uint8_t  state[MAX_RECORDS];                /* req_state_t */
+    uint8_t  retries[MAX_RECORDS];              /* this cycle */
+    uint8_t  gen[MAX_RECORDS];                  /* cycle_gen when value came in */
+    int8_t   rssi[MAX_RECORDS];                 /* of the status value came in */
+    uint8_t  ttl[MAX_RECORDS];                  /* with, as received */
+    uint16_t timeout_ms[MAX_RECORDS];           /* per GET */
+    uint32_t sent_ms[MAX_RECORDS];              /* uptime when the GET went out */
+    uint32_t rx_ms[MAX_RECORDS];                /* uptime when value came in */
+    uint32_t retry_at[MAX_RECORDS];             /* uptime of the next retry */
+    uint8_t  raw[MAX_RECORDS][REC_RAW_MAX];     /* value as encoded on the mesh */
+} sensor_table_t;
+
+static sensor_table_t sensor_table;
+static size_t         sensor_count;
+static uint8_t        cycle_gen = 1;
+
+/* Discovered servers (node primary addresses), and the table, poll plan and
+ * shard generations the records were built from.
+ */
+static const struct discovery_node *servers;
+static size_t                       server_count;
+static uint32_t                     table_gen;
+static uint32_t                     plan_gen;
+static uint32_t                     shard_gen;
+
+/* Shard and poll plan generations discovery last swept with, see
+ * server_wanted()
+ */
+static uint32_t                     swept_shard_gen;
+static uint32_t                     swept_plan_gen;
+
+/* Path statistics per server: how many GETs went out, how many statuses
+ * came back, round-trip latency and the TTL the statuses arrived with. Servers scope their responses to the hop count towards us,
+ * so recv_ttl should sit at GW_PATH_TTL_MARGIN + 1 once the path is learned.
+ * The RTT of a late status still goes into the histogram, as it is what
+ * REQUEST_TIMEOUT_MS should be sized from.
+ *
+ * The RSSI is that of the last hop, the relay or server we heard the
+ * status from, and counts every status, duplicates included. The hop
+ * count comes from the statuses that were not scoped (see
+ * discovery_hops()), and before the first of those from discovery.
+ */
+typedef struct {
+    uint32_t        tx;
+    uint32_t        rx;
+    uint32_t        lost;       /* GETs that timed out */
+    uint32_t        late;       /* statuses after their GET timed out */
+    uint32_t        dup;        /* statuses for a reading already in */
+    struct rtt_hist rtt;
+    uint8_t         last_ttl;
+    uint8_t         hops;       /* 0 if unknown */
+    int8_t          rssi_min;
+    int8_t          rssi_max;
+    int32_t         rssi_sum;
+    uint32_t        rssi_count;
+} path_stats_t;
+
+static path_stats_t path_stats[MAX_SERVERS];
+
+/* Per record only the counts, which stop at UINT16_MAX until "stats
+ * reset". Latency, TTL and RSSI are per server, in path_stats.
+ */
+typedef struct {
+    uint16_t tx;
+    uint16_t rx;
+    uint16_t lost;
+    uint16_t late;
+    uint16_t dup;
+} rec_stats_t;
+
+static rec_stats_t sensor_stats[MAX_RECORDS];
+
+static inline void count16(uint16_t *counter)
+{
+    if (*counter < UINT16_MAX) {
+        (*counter)++;
+    }
+}
+
+/* Histogram summaries on the UART every STATS_INTERVAL_MS, and on demand
+ * with the "stats show" shell command.
+ */
+#define STATS_INTERVAL_MS  60000
 
-static sensor_record_t sensor_table[SENSOR_COUNT];
-// end
+static void count_tx(size_t idx)
+{
+    path_stats[sensor_table.server[idx]].tx++;
+    count16(&sensor_stats[idx].tx);
+}
 
-static void init_sensor_table(void)
+/* TTL, hops and RSSI of a status. Call with req_lock held. */
+static void count_path(path_stats_t *ps, const struct bt_mesh_msg_ctx *ctx)
 {
-    const size_t n_defs = ARRAY_SIZE(sensor_defs);
-    for (size_t srv = 0; srv < ARRAY_SIZE(server_addrs); srv++) {
-        uint16_t primary = server_addrs[srv];
+    uint8_t hops = discovery_hops(ctx->recv_ttl);
+
+    ps->last_ttl = ctx->recv_ttl;
+    if (hops) {
+        ps->hops = hops;
+    }
+
+    if (!ps->rssi_count || ctx->recv_rssi < ps->rssi_min) {
+        ps->rssi_min = ctx->recv_rssi;
+    }
+    if (!ps->rssi_count || ctx->recv_rssi > ps->rssi_max) {
+        ps->rssi_max = ctx->recv_rssi;
+    }
+    ps->rssi_sum += ctx->recv_rssi;
+    ps->rssi_count++;
+}
+
+static int8_t rssi_avg(const path_stats_t *ps)
+{
+    return ps->rssi_count ? ps->rssi_sum / (int32_t)ps->rssi_count : 0;
+}
+
+/* Hops to srv as last seen, or as discovery found them */
+static uint8_t server_hops(size_t srv)
+{
+    return path_stats[srv].hops ? path_stats[srv].hops : servers[srv].hops;
+}
+
+/*
+ * Per-server liveness. A server that lets DEAD_AFTER_CYCLES cycles in a row
+ * go by without a single status is taken out of the normal polling and only
+ * gets one probe GET every PROBE_INTERVAL_MS, so it no longer holds up the
+ * cycle with a window full of timeouts. Any sign of life brings it back:
+ * a status, solicited or published, or a heartbeat. Zephyr keeps a single
+ * heartbeat subscription, so heartbeats only cover the node set as its
+ * source; the others are judged on their statuses alone.
+ */
+#define DEAD_AFTER_CYCLES  3
+#define PROBE_INTERVAL_MS  60000
+
+typedef struct {
+    bool     dead;
+    uint8_t  misses;        /* consecutive cycles without a status */
+    bool     seen;          /* status or heartbeat since the cycle started */
+    uint32_t next_probe_ms;
+} liveness_t;
+
+static liveness_t liveness[MAX_SERVERS];
+
+/* Per polling mode: GETs sent, statuses expected and received, over all
+ * cycles. Group GETs expect one status per matching record.
+ */
+typedef struct {
+    uint32_t cycles;
+    uint32_t requests;
+    uint32_t expected;
+    uint32_t received;
+    uint32_t retries;
+} mode_stats_t;
+
+static mode_stats_t mode_stats[POLL_MODES];
+
+/* Passive mode: statuses forwarded, repeats dropped, and statuses from
+ * elements not in the table (another gateway's shard, or not discovered)
+ */
+typedef struct {
+    uint32_t forwarded;
+    uint32_t dup;
+    uint32_t unknown;
+} passive_stats_t;
+
+static passive_stats_t passive_stats;
+
+static const char *const mode_names[POLL_MODES] = {
+    [POLL_UNICAST]   = "unicast",
+    [POLL_MULTICAST] = "multicast",
+    [POLL_ELEMENT]   = "element",
+};
+
+static const sensor_label_t *sensor_label(uint16_t prop_id)
+{
+    for (size_t l = 0; l < ARRAY_SIZE(sensor_labels); l++) {
+        if (sensor_labels[l].type->id == prop_id) {
+            return &sensor_labels[l];
+        }
+    }
+
+    return NULL;
+}
+
+/* The group polled every period_ms, added if there is none yet */
+static int group_for(uint32_t period_ms)
+{
+    for (size_t g = 0; g < group_count; g++) {
+        if (group_period[g] == period_ms) {
+            return g;
+        }
+    }
+
+    if (group_count == MAX_GROUPS) {
+        return -ENOMEM;
+    }
+
+    group_period[group_count] = period_ms;
+    return group_count++;
+}
+
+static const struct bt_mesh_sensor_type *rec_type(size_t idx)
+{
+    return poll_types[sensor_table.type[idx]];
+}
+
+/* Column label, or NULL for types we have none for */
+static const char *rec_name(size_t idx)
+{
+    const sensor_label_t *label = sensor_label(rec_type(idx)->id);
+
+    return label ? label->name : NULL;
+}
+
+/* Context for a unicast GET to the record's element */
+static void rec_ctx(size_t idx, struct bt_mesh_msg_ctx *ctx)
+{
+    *ctx = (struct bt_mesh_msg_ctx) {
+        .net_idx  = NET_IDX,
+        .app_idx  = APP_IDX,
+        .addr     = sensor_table.addr[idx],
+        .send_ttl = DEFAULT_TTL,
+    };
+}
+
+static const struct bt_mesh_sensor_format *rec_format(size_t idx)
+{
+    return rec_type(idx)->channels[0].format;
+}
+
+static void rec_value(size_t idx, struct bt_mesh_sensor_value *value)
+{
+    value->format = rec_format(idx);
+    memcpy(value->raw, sensor_table.raw[idx], value->format->size);
+}
+
+/* Whether the record has a value from the current cycle */
+static bool rec_fresh(size_t idx)
+{
+    return sensor_table.gen[idx] == cycle_gen;
+}
+
+/* Index of type in poll_types[], added if new, or -ENOMEM */
+static int type_index(const struct bt_mesh_sensor_type *type)
+{
+    size_t t;
+
+    for (t = 0; t < poll_type_count; t++) {
+        if (poll_types[t] == type) {
+            return t;
+        }
+    }
+    if (poll_type_count == MAX_TYPES) {
+        return -ENOMEM;
+    }
+
+    poll_types[poll_type_count] = type;
+    return poll_type_count++;
+}
+
+/* Whether server is this gateway's to poll: in the poll plan's server
+ * list if it has one, which is the host's own split and is taken as it
+ * is, in this gateway's shard otherwise.
+ *
+ * This is also the discovery filter, so only the servers this gateway
+ * polls take room in the table and more gateways hold more servers
+ * between them. When the shard or the plan changes, get_data() has the
+ * network swept again; until then the old table is polled as far as it
+ * still applies.
+ */
+static bool server_wanted(uint16_t server)
+{
+    const struct poll_plan *plan = poll_plan_get();
+
+    return plan->server_count ? poll_plan_has_server(plan, server) : shard_owns(server);
+}
+
+/* Build the records from the discovered table, as far as the poll plan
+ * wants them polled and they are in this gateway's shard (server_wanted()).
+ * Discovery has filtered on the same, but the shard may have moved since.
+ */
+static void load_sensor_table(void)
+{
+    const struct discovery_sensor *found;
+    const struct poll_plan *plan = poll_plan_get();
+    size_t n_found = discovery_sensors(&found);
+    size_t polled = 0;
+    uint16_t timeout_ms = plan->timeout_ms ? plan->timeout_ms : REQUEST_TIMEOUT_MS;
+
+    server_count = discovery_nodes(&servers);
+    sensor_count = 0;
+    poll_type_count = 0;
+
+    for (group_count = 0; group_count < POLL_CLASSES; group_count++) {
+        group_period[group_count] = poll_classes[group_count].period_ms;
+    }
+
+    for (size_t i = 0; i < n_found && sensor_count < MAX_RECORDS; i++) {
+        const struct bt_mesh_sensor_type *type = bt_mesh_sensor_type_get(found[i].prop_id);
+        const sensor_label_t *label = sensor_label(found[i].prop_id);
+        const struct poll_plan_prop *pp = poll_plan_prop(plan, found[i].prop_id);
+        size_t idx = sensor_count;
+        int group = label ? label->class : CLASS_NORMAL;
+        uint16_t server = servers[found[i].node].addr;
+        int t;
+
+        if (!type || !server_wanted(server)) {
+            continue;
+        }
+
+        if (pp) {
+            group = pp->period_ms ? group_for(pp->period_ms) : -ENOENT;
+        } else if (plan->flags & POLL_PLAN_ONLY_LISTED) {
+            group = -ENOENT;
+        }
+        if (group < 0) {
+            continue;
+        }
+
+        t = type_index(type);
+        if (t < 0) {
+            printk("0x%04X: more than %u sensor types, 0x%04X skipped\n",
+                   found[i].addr, MAX_TYPES, found[i].prop_id);
+            continue;
+        }
 
-        for (size_t s = 0; s < n_defs; s++) {
-            size_t idx = srv * n_defs + s;
+        sensor_table.addr[idx]       = found[i].addr;
+        sensor_table.type[idx]       = t;
+        sensor_table.server[idx]     = found[i].node;
+        sensor_table.group[idx]      = group;
+        sensor_table.state[idx]      = REQ_IDLE;
+        sensor_table.retries[idx]    = 0;
+        sensor_table.gen[idx]        = 0;
+        sensor_table.timeout_ms[idx] = (pp && pp->timeout_ms) ? pp->timeout_ms : timeout_ms;
+        if (POLL_MODE == POLL_MULTICAST || POLL_MODE == POLL_ALTERNATE) {
+            sensor_table.timeout_ms[idx] = MAX(sensor_table.timeout_ms[idx],
+                                               GROUP_TIMEOUT_MIN_MS);
+        }
+        sensor_count++;
+    }
+
+    /* Records are in server order */
+    for (size_t i = 0; i < sensor_count; i++) {
+        if (!i || sensor_table.server[i] != sensor_table.server[i - 1]) {
+            polled++;
+        }
+    }
+    shard_set_polled(polled);
 
-            sensor_table[idx].name = sensor_defs[s].name;
-            sensor_table[idx].type = sensor_defs[s].type;
-            sensor_table[idx].valid = false;
+    memset(path_stats, 0, sizeof(path_stats));
+    memset(sensor_stats, 0, sizeof(sensor_stats));
+    memset(liveness, 0, sizeof(liveness));
+    printk("Polling %u sensors on %u of %u servers\n",
+           (unsigned)sensor_count, (unsigned)polled, (unsigned)server_count);
+}
 
-            /* pre‐build the context if you like, or rebuild in get_data() */
-            sensor_table[idx].ctx.net_idx  = NET_IDX;
-            sensor_table[idx].ctx.app_idx  = APP_IDX;
-            sensor_table[idx].ctx.addr     = primary + sensor_defs[s].elem_offset;
-            sensor_table[idx].ctx.send_ttl = DEFAULT_TTL;
+/* Rebuild the reply index; call whenever sensor_table addresses change */
+static void build_dispatch(void)
+{
+    dispatch_reset();
+
+    for (size_t i = 0; i < sensor_count; i++) {
+        int err = dispatch_add(sensor_table.addr[i],
+                               rec_type(i)->id, i);
+        if (err) {
+            printk("Dispatch index full at record %u (err %d)\n",
+                   (unsigned)i, err);
+            return;
         }
     }
 }
 
+/* Each entry has a record behind it, so a full table always fits */
+BUILD_ASSERT(SCHED_MAX_ENTRIES >= MAX_RECORDS, "scheduler smaller than the sensor table");
+
+/* One scheduler entry per (server, group) that has sensors, all due now */
+static void build_schedule(void)
+{
+    uint32_t now = k_uptime_get_32();
+
+    sched_reset(now);
+
+    for (size_t srv = 0; srv < server_count; srv++) {
+        for (uint8_t g = 0; g < group_count; g++) {
+            for (size_t i = 0; i < sensor_count; i++) {
+                if (sensor_table.server[i] != srv || sensor_table.group[i] != g) {
+                    continue;
+                }
+                if (sched_add(srv, g, group_period[g], now)) {
+                    printk("Schedule full at server 0x%04X\n", servers[srv].addr);
+                    return;
+                }
+                break;
+            }
+        }
+    }
+}
 
 static bool is_occupied;
 static struct k_work_delayable motion_timeout_work;
@@ -85,23 +625,179 @@ static void motion_timeout(struct k_work *work)
 	printk("Area is now vacant.\n");
 }
 
+static struct k_work_delayable get_data_work;
+static struct k_spinlock req_lock;
+static uint32_t outstanding;    /* records in REQ_PENDING */
+static uint32_t retrying;       /* records in REQ_RETRY */
+
+/* Whether value repeats the one stored in record idx */
+static bool same_value(size_t idx, const struct bt_mesh_sensor_value *value)
+{
+    return value->format == rec_format(idx) &&
+           !memcmp(sensor_table.raw[idx], value->raw, value->format->size);
+}
+
+/* Store a status in record idx. Call with req_lock held. */
+static void store_value(size_t idx, const struct bt_mesh_msg_ctx *ctx,
+                        const struct bt_mesh_sensor_value *value, uint32_t now)
+{
+    memcpy(sensor_table.raw[idx], value->raw, MIN(value->format->size, REC_RAW_MAX));
+    sensor_table.rx_ms[idx] = now;
+    sensor_table.rssi[idx]  = ctx->recv_rssi;
+    sensor_table.ttl[idx]   = ctx->recv_ttl;
+    sensor_table.gen[idx]   = cycle_gen;
+}
+
+/* One record as it came in, for passive mode: a FRAME_TYPE_READINGS frame
+ * of its own, or a READING text line.
+ */
+static void forward_reading(size_t idx, uint32_t now)
+{
+    uint8_t srv = sensor_table.server[idx];
+    uint8_t len = rec_format(idx)->size;
+
+    if (OUTPUT_FORMAT == OUTPUT_BINARY) {
+        struct frame frame;
+
+        frame_begin(&frame, FRAME_TYPE_READINGS, now);
+        frame_put_le16(&frame, servers[srv].addr);
+        frame_put_u8(&frame, 1);
+        frame_put_le16(&frame, sensor_table.addr[idx]);
+        frame_put_le16(&frame, rec_type(idx)->id);
+        frame_put_u8(&frame, FRAME_STATUS_OK);
+        frame_put_le16(&frame, 0);
+        frame_put_u8(&frame, (uint8_t)sensor_table.rssi[idx]);
+        frame_put_u8(&frame, sensor_table.ttl[idx]);
+        frame_put_u8(&frame, server_hops(srv));
+        frame_put_u8(&frame, len);
+        frame_put_bytes(&frame, sensor_table.raw[idx], len);
+        frame_send(&frame);
+    } else {
+        struct bt_mesh_sensor_value value;
+        float vf = 0.0f;
+
+        rec_value(idx, &value);
+        bt_mesh_sensor_value_to_float(&value, &vf);
+        printk("READING 0x%04X,0x%04X,%u,%.2f,%u,%d,%u\n",
+               sensor_table.addr[idx], rec_type(idx)->id, (unsigned)now, (double)vf,
+               sensor_table.ttl[idx], sensor_table.rssi[idx], server_hops(srv));
+    }
+}
+
 static void sensor_cli_data_cb(struct bt_mesh_sensor_cli *cli,
                                struct bt_mesh_msg_ctx   *ctx,
                                const struct bt_mesh_sensor_type *sensor,
                                const struct bt_mesh_sensor_value *value)
 {
-    for (int i = 0; i < SENSOR_COUNT; i++) {
-        /* Match on both property ID *and* element/server address */
-        if (sensor_table[i].type->id == sensor->id
-            && sensor_table[i].ctx.addr  == ctx->addr) {
-            sensor_table[i].value = *value;
-            sensor_table[i].valid = true;
-            printk("Received %s from 0x%04x (id=0x%04X)\n",
-                   sensor_table[i].name,
-                   ctx->addr,
-                   sensor->id);
-            break;
+    /* Match on both property ID *and* element/server address */
+    int i = dispatch_find(ctx->addr, sensor->id);
+
+    if (i < 0) {
+        if (INGEST_MODE == INGEST_PASSIVE) {
+            passive_stats.unknown++;
+        }
+        return;
+    }
+
+    path_stats_t *ps = &path_stats[sensor_table.server[i]];
+    rec_stats_t *ss = &sensor_stats[i];
+    uint32_t now = k_uptime_get_32();
+    uint32_t rtt = now - sensor_table.sent_ms[i];
+    bool completed = false;
+    bool answer = false;
+    k_spinlock_key_t key = k_spin_lock(&req_lock);
+
+    if (INGEST_MODE == INGEST_PASSIVE) {
+        liveness[sensor_table.server[i]].seen = true;
+        count_path(ps, ctx);
+
+        /* The record keeps the time of the first copy, so the window
+         * does not slide along with the retransmissions
+         */
+        if (rec_fresh(i) &&
+            now - sensor_table.rx_ms[i] < PASSIVE_DEDUP_MS &&
+            same_value(i, value)) {
+            ps->dup++;
+            count16(&ss->dup);
+            passive_stats.dup++;
+            k_spin_unlock(&req_lock, key);
+            return;
+        }
+
+        ps->rx++;
+        count16(&ss->rx);
+        passive_stats.forwarded++;
+        store_value(i, ctx, value, now);
+        k_spin_unlock(&req_lock, key);
+
+        forward_reading(i, now);
+        if (OUTPUT_TRACE) {
+            printk("Published %s from 0x%04x (id=0x%04X), ttl %u, rssi %d\n",
+                   rec_name(i), ctx->addr, sensor->id, ctx->recv_ttl, ctx->recv_rssi);
         }
+        return;
+    }
+
+    switch (sensor_table.state[i]) {
+    case REQ_PENDING:
+    case REQ_RETRY:
+        /* A late reply to the first GET also settles a queued retry */
+        if (sensor_table.state[i] == REQ_PENDING) {
+            outstanding--;
+        } else {
+            retrying--;
+            ps->late++;
+            count16(&ss->late);
+        }
+        sensor_table.state[i] = REQ_DONE;
+        completed = true;
+        answer = true;
+        ps->rx++;
+        count16(&ss->rx);
+        rtt_hist_add(&ps->rtt, rtt);
+        break;
+    case REQ_TIMEOUT:
+        ps->late++;
+        count16(&ss->late);
+        answer = true;
+        rtt_hist_add(&ps->rtt, rtt);
+        break;
+    case REQ_DONE:
+        /* Relayed twice, or answered both a GET and its retry */
+        ps->dup++;
+        count16(&ss->dup);
+        break;
+    default:
+        /* Published, an answer to a group GET this record was not in, or
+         * a straggler from the previous cycle
+         */
+        break;
+    }
+    count_path(ps, ctx);
+    liveness[sensor_table.server[i]].seen = true;
+
+    /* Only an answer to this cycle's GET is this cycle's value. Late
+     * statuses still carry a fresh one.
+     */
+    if (answer) {
+        store_value(i, ctx, value, now);
+    }
+
+    k_spin_unlock(&req_lock, key);
+
+    if (OUTPUT_TRACE) {
+        printk("Received %s from 0x%04x (id=0x%04X) in %u ms, ttl %u, rssi %d\n",
+               rec_name(i),
+               ctx->addr,
+               sensor->id,
+               rtt,
+               ctx->recv_ttl,
+               ctx->recv_rssi);
+    }
+
+    /* A window slot opened up, or the cycle may be complete */
+    if (completed) {
+        k_work_reschedule(&get_data_work, K_NO_WAIT);
     }
 }
 
@@ -111,9 +807,7 @@ static void sensor_cli_series_entry_cb(struct bt_mesh_sensor_cli *cli, struct bt
 				       uint8_t count,
 				       const struct bt_mesh_sensor_series_entry *entry)
 {
-	printk("Relative runtime in %s", bt_mesh_sensor_ch_str(&entry->value[1]));
-	printk(" to %s degrees: ", bt_mesh_sensor_ch_str(&entry->value[2]));
-	printk("%s percent\n", bt_mesh_sensor_ch_str(&entry->value[0]));
+	series_entry(ctx, sensor, index, count, entry);
 }
 
 static void sensor_cli_setting_status_cb(struct bt_mesh_sensor_cli *cli,
@@ -135,6 +829,8 @@ static void sensor_cli_desc_cb(struct bt_mesh_sensor_cli *cli, struct bt_mesh_ms
 	printk("\ttolerance: { positive: %d negative: %d }\n",
 	       sensor->descriptor.tolerance.positive, sensor->descriptor.tolerance.negative);
 	printk("\tsampling type: %d\n", sensor->descriptor.sampling_type);
+
+	discovery_sensor_desc(ctx, sensor);
 }
 
 static const struct bt_mesh_sensor_cli_handlers bt_mesh_sensor_cli_handlers = {
@@ -146,11 +842,809 @@ static const struct bt_mesh_sensor_cli_handlers bt_mesh_sensor_cli_handlers = {
 
 static struct bt_mesh_sensor_cli sensor_cli = BT_MESH_SENSOR_CLI_INIT(&bt_mesh_sensor_cli_handlers);
 
-static struct k_work_delayable get_data_work;
+/* GETs in flight at any time, across all servers. Bounded by the mesh
+ * advertising buffers: every GET and every relayed status needs one.
+ */
+#define GET_WINDOW              4
+
+/* Missing readings are asked for again, one unicast GET per missing
+ * (element, property) pair, after RETRY_BACKOFF_MS, then twice that, and
+ * so on up to RETRY_MAX times. RETRY_BUDGET caps the retries of a whole
+ * cycle so a dead server cannot stall it.
+ */
+#define RETRY_MAX               3
+#define RETRY_BACKOFF_MS        250
+#define RETRY_BUDGET            16
+
+/* Series sensors (histograms, history buckets) are polled for their plain
+ * value like the others, and on top of that fetched whole with one Series
+ * Get every SERIES_PERIOD_MS, see series.h. The first fetch comes
+ * SERIES_DELAY_MS after the table is built, behind the first cycle.
+ */
+#define SERIES_PERIOD_MS        (10 * 60 * 1000)
+#define SERIES_DELAY_MS         10000
+
+static struct k_work_delayable series_work;
+
+static void fetch_series(struct k_work *work)
+{
+    for (size_t i = 0; i < sensor_count; i++) {
+        int err;
+
+        if (!(rec_type(i)->flags & BT_MESH_SENSOR_TYPE_FLAG_SERIES) ||
+            liveness[sensor_table.server[i]].dead) {
+            continue;
+        }
+
+        err = series_fetch(sensor_table.addr[i], rec_type(i), NULL);
+        if (err == -ENOMEM) {
+            printk("Series queue full at 0x%04X\n", sensor_table.addr[i]);
+            break;
+        }
+    }
+
+    k_work_schedule(&series_work, K_MSEC(SERIES_PERIOD_MS));
+}
+
+
+static uint8_t frame_status(size_t idx)
+{
+    if (rec_fresh(idx)) {
+        return FRAME_STATUS_OK;
+    }
+
+    switch (sensor_table.state[idx]) {
+    case REQ_FAILED:
+        return FRAME_STATUS_FAILED;
+    case REQ_SKIPPED:
+        return FRAME_STATUS_SKIPPED;
+    default:
+        return FRAME_STATUS_TIMEOUT;
+    }
+}
+
+/* The records of srv polled this cycle as FRAME_TYPE_READINGS, split over
+ * as many frames as it takes.
+ */
+static void send_readings(size_t srv, uint32_t now)
+{
+    struct frame frame;
+    size_t count_at = 0;
+    uint8_t count = 0;
+
+    for (size_t idx = 0; idx < sensor_count; idx++) {
+        uint8_t status;
+        uint8_t len = 0;
+
+        if (sensor_table.server[idx] != srv || sensor_table.state[idx] == REQ_IDLE) {
+            continue;
+        }
+
+        status = frame_status(idx);
+        if (status == FRAME_STATUS_OK) {
+            len = rec_format(idx)->size;
+        }
+
+        if (count && frame_room(&frame) < 11 + len) {
+            frame.buf[count_at] = count;
+            frame_send(&frame);
+            count = 0;
+        }
+
+        if (!count) {
+            frame_begin(&frame, FRAME_TYPE_READINGS, now);
+            frame_put_le16(&frame, servers[srv].addr);
+            count_at = frame.len;
+            frame_put_u8(&frame, 0);
+        }
+
+        frame_put_le16(&frame, sensor_table.addr[idx]);
+        frame_put_le16(&frame, rec_type(idx)->id);
+        frame_put_u8(&frame, status);
+        frame_put_le16(&frame, status == FRAME_STATUS_OK ?
+                               MIN(now - sensor_table.rx_ms[idx], UINT16_MAX) : 0);
+        frame_put_u8(&frame, status == FRAME_STATUS_OK ? (uint8_t)sensor_table.rssi[idx] : 0);
+        frame_put_u8(&frame, status == FRAME_STATUS_OK ? sensor_table.ttl[idx] : 0);
+        frame_put_u8(&frame, server_hops(srv));
+        frame_put_u8(&frame, len);
+        frame_put_bytes(&frame, sensor_table.raw[idx], len);
+        count++;
+    }
+
+    if (count) {
+        frame.buf[count_at] = count;
+        frame_send(&frame);
+    }
+}
+
+/* Whether the record's server has the same property on another element too */
+static bool rec_repeated(size_t idx)
+{
+    for (size_t i = 0; i < sensor_count; i++) {
+        if (i != idx && sensor_table.server[i] == sensor_table.server[idx] &&
+            sensor_table.type[i] == sensor_table.type[idx]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void print_csv(size_t srv, uint32_t now, bool header)
+{
+    /* Every server has its own set of sensors, so its own header */
+    if (header) {
+        printk("SERVER 0x%04X, timestamp_ms", servers[srv].addr);
+        for (size_t idx = 0; idx < sensor_count; idx++) {
+            if (sensor_table.server[idx] != srv) {
+                continue;
+            }
+            if (rec_name(idx)) {
+                printk(",%s", rec_name(idx));
+            } else {
+                printk(",0x%04X", rec_type(idx)->id);
+            }
+            /* One element per load cell: Mass +7, Mass +8, ... */
+            if (rec_repeated(idx)) {
+                printk(" +%u", sensor_table.addr[idx] - servers[srv].addr);
+            }
+        }
+        printk("\n");
+    }
+
+    /* CSV data row for this server */
+    printk("0x%04X,%u",
+           servers[srv].addr,
+           (unsigned)now);
+    for (size_t idx = 0; idx < sensor_count; idx++) {
+        if (sensor_table.server[idx] != srv) {
+            continue;
+        }
+        /* Records not due this cycle show their last value */
+        if (rec_fresh(idx) ||
+            (sensor_table.state[idx] == REQ_IDLE && sensor_table.gen[idx])) {
+            struct bt_mesh_sensor_value value;
+            float vf = 0.0f;
+
+            rec_value(idx, &value);
+            bt_mesh_sensor_value_to_float(&value, &vf);
+            printk(",%.2f", (double)vf);
+        } else {
+            printk(","); /* blank on timeout */
+        }
+    }
+    printk("\n");
+}
+
+/* The path statistics of srv as FRAME_TYPE_PATH */
+static void send_path(size_t srv, uint32_t now)
+{
+    const path_stats_t *ps = &path_stats[srv];
+    struct frame frame;
+
+    frame_begin(&frame, FRAME_TYPE_PATH, now);
+    frame_put_le16(&frame, servers[srv].addr);
+    frame_put_u8(&frame, !liveness[srv].dead);
+    frame_put_le32(&frame, ps->tx);
+    frame_put_le32(&frame, ps->rx);
+    frame_put_le32(&frame, ps->lost);
+    frame_put_le32(&frame, ps->late);
+    frame_put_le32(&frame, ps->dup);
+    frame_put_le16(&frame, MIN(rtt_hist_percentile(&ps->rtt, 50), UINT16_MAX));
+    frame_put_le16(&frame, MIN(rtt_hist_percentile(&ps->rtt, 90), UINT16_MAX));
+    frame_put_le16(&frame, MIN(ps->rtt.max_ms, UINT16_MAX));
+    frame_put_u8(&frame, ps->last_ttl);
+    frame_put_u8(&frame, server_hops(srv));
+    frame_put_u8(&frame, (uint8_t)rssi_avg(ps));
+    frame_put_u8(&frame, (uint8_t)ps->rssi_min);
+    frame_put_u8(&frame, (uint8_t)ps->rssi_max);
+    frame_put_le32(&frame, ps->rssi_count);
+    frame_send(&frame);
+}
+
+/* path summary for this server */
+static void print_path(size_t srv, uint32_t now)
+{
+    const path_stats_t *ps = &path_stats[srv];
+
+    if (OUTPUT_FORMAT == OUTPUT_BINARY) {
+        send_path(srv, now);
+    }
+
+    if (!OUTPUT_TRACE) {
+        return;
+    }
+
+    printk("PATH 0x%04X: %s tx=%u rx=%u rtt_avg=%u ms rtt_max=%u ms ttl=%u hops=%u "
+           "rssi_avg=%d rssi_min=%d rssi_max=%d\n",
+           servers[srv].addr,
+           liveness[srv].dead ? "down" : "up",
+           ps->tx,
+           ps->rx,
+           ps->rtt.count ? ps->rtt.sum_ms / ps->rtt.count : 0,
+           ps->rtt.max_ms,
+           ps->last_ttl,
+           server_hops(srv),
+           rssi_avg(ps),
+           ps->rssi_min,
+           ps->rssi_max);
+}
+
+static void print_server(size_t srv, uint32_t now, bool header)
+{
+    if (OUTPUT_FORMAT == OUTPUT_BINARY) {
+        send_readings(srv, now);
+    } else {
+        print_csv(srv, now, header);
+    }
+
+    print_path(srv, now);
+}
+
+/* printk, or the shell that ran the command */
+static void stats_out(const struct shell *sh, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+#if defined(CONFIG_SHELL)
+    if (sh) {
+        shell_vfprintf(sh, SHELL_NORMAL, fmt, args);
+        va_end(args);
+        return;
+    }
+#endif
+    vprintk(fmt, args);
+    va_end(args);
+}
+
+static void stats_line(const struct shell *sh, const path_stats_t *ps)
+{
+    const struct rtt_hist *h = &ps->rtt;
+
+    stats_out(sh, " tx=%u rx=%u lost=%u late=%u dup=%u n=%u p50=%u p90=%u p99=%u max=%u ms "
+              "ttl=%u rssi=%d/%d/%d hist=",
+              ps->tx, ps->rx, ps->lost, ps->late, ps->dup, h->count,
+              rtt_hist_percentile(h, 50),
+              rtt_hist_percentile(h, 90),
+              rtt_hist_percentile(h, 99),
+              h->max_ms,
+              ps->last_ttl,
+              ps->rssi_min,
+              rssi_avg(ps),
+              ps->rssi_max);
+    for (int b = 0; b < RTT_HIST_BUCKETS; b++) {
+        stats_out(sh, b ? ",%u" : "%u", h->bucket[b]);
+    }
+    stats_out(sh, "\n");
+}
+
+static void uart_line(const struct shell *sh)
+{
+    struct uart_out_stats us;
+
+    uart_out_stats_get(&us);
+    stats_out(sh, "UART: sent=%u dropped=%u bytes in %u writes high_water=%u/%u rx_dropped=%u lines\n",
+              us.bytes, us.dropped_bytes, us.dropped_writes, us.high_water,
+              UART_OUT_BUF_SIZE, us.dropped_lines);
+}
+
+/* RTT histograms and loss per server, then the counts per sensor */
+static void stats_dump(const struct shell *sh)
+{
+    uart_line(sh);
+    if (!sh) {
+        shard_print();
+    }
+
+    stats_out(sh, "RTT buckets (ms from):");
+    for (int b = 0; b < RTT_HIST_BUCKETS; b++) {
+        stats_out(sh, " %u", rtt_hist_bucket_floor(b));
+    }
+    stats_out(sh, "\n");
+
+    for (size_t srv = 0; srv < server_count; srv++) {
+        stats_out(sh, "RTT 0x%04X:", servers[srv].addr);
+        stats_line(sh, &path_stats[srv]);
+    }
+
+    for (size_t i = 0; i < sensor_count; i++) {
+        const rec_stats_t *rs = &sensor_stats[i];
+
+        stats_out(sh, "REC 0x%04X/0x%04X: tx=%u rx=%u lost=%u late=%u dup=%u\n",
+                  sensor_table.addr[i], rec_type(i)->id,
+                  rs->tx, rs->rx, rs->lost, rs->late, rs->dup);
+    }
+}
+
+static void print_cycle(void)
+{
+    uint32_t now = k_uptime_get_32();
+
+    /* CSV headers once in a while, if you like—optional */
+    static uint32_t last_header;
+    bool header = (now - last_header > 10000);
+
+    static uint32_t last_stats;
+
+    if (header) {
+        last_header = now;
+    }
+
+    /* Only the servers with a class due this cycle */
+    for (size_t srv = 0; srv < server_count; srv++) {
+        for (size_t i = 0; i < sensor_count; i++) {
+            if (sensor_table.server[i] == srv && sensor_table.state[i] != REQ_IDLE) {
+                print_server(srv, now, header);
+                break;
+            }
+        }
+    }
+
+    for (int m = 0; m < POLL_MODES; m++) {
+        const mode_stats_t *ms = &mode_stats[m];
+        uint32_t lost = ms->expected - ms->received;
+
+        printk("LOSS %s: cycles=%u req=%u retry=%u rx=%u/%u lost=%u.%u %%\n",
+               mode_names[m],
+               ms->cycles,
+               ms->requests,
+               ms->retries,
+               ms->received,
+               ms->expected,
+               ms->expected ? 100 * lost / ms->expected : 0,
+               ms->expected ? (1000 * lost / ms->expected) % 10 : 0);
+    }
+
+    /* Utilization is the share of time spent with a cycle running;
+     * lateness is how long due entries waited for the previous cycle.
+     */
+    {
+        const struct sched_stats *ss = sched_stats_get();
+        uint32_t elapsed = now - ss->since_ms;
+        uint32_t util = elapsed ? (uint32_t)(1000ULL * ss->busy_ms / elapsed) : 0;
+
+        printk("SCHED: util=%u.%u %% dispatched=%u late_avg=%u ms late_max=%u ms overruns=%u\n",
+               util / 10,
+               util % 10,
+               ss->dispatched,
+               ss->dispatched ? ss->late_sum_ms / ss->dispatched : 0,
+               ss->late_max_ms,
+               ss->overruns);
+    }
+
+    /* The dump starts with the UART line. Dropped output shows up on the
+     * host as gaps in the frame seq and as holes in the text.
+     */
+    if (now - last_stats > STATS_INTERVAL_MS) {
+        last_stats = now;
+        stats_dump(NULL);
+    } else {
+        uart_line(NULL);
+    }
+}
+
+/* Decide which servers get polled this cycle. Call with the records of the
+ * due classes REQ_QUEUED; those of servers that are down and not due for a
+ * probe become REQ_SKIPPED, and a due probe asks for the first one only.
+ */
+static void plan_cycle(uint32_t now)
+{
+    k_spinlock_key_t key = k_spin_lock(&req_lock);
+
+    for (size_t srv = 0; srv < server_count; srv++) {
+        liveness_t *lv = &liveness[srv];
+        bool probe;
+
+        /* Published status or heartbeat between cycles */
+        if (lv->dead && lv->seen) {
+            lv->dead   = false;
+            lv->misses = 0;
+            printk("Server 0x%04X is back\n", servers[srv].addr);
+        }
+        lv->seen = false;
+
+        if (!lv->dead) {
+            continue;
+        }
+
+        probe = (int32_t)(now - lv->next_probe_ms) >= 0;
+        if (probe) {
+            lv->next_probe_ms = now + PROBE_INTERVAL_MS;
+        }
+
+        for (size_t i = 0; i < sensor_count; i++) {
+            if (sensor_table.server[i] != srv || sensor_table.state[i] != REQ_QUEUED) {
+                continue;
+            }
+            if (probe) {
+                probe = false;  /* leave the first record queued */
+            } else {
+                sensor_table.state[i] = REQ_SKIPPED;
+            }
+        }
+    }
+
+    k_spin_unlock(&req_lock, key);
+}
+
+/* Count a cycle without any status against every server that was asked */
+static void update_liveness(uint32_t now)
+{
+    k_spinlock_key_t key = k_spin_lock(&req_lock);
+
+    for (size_t srv = 0; srv < server_count; srv++) {
+        liveness_t *lv = &liveness[srv];
+        bool asked = false;
+
+        if (lv->seen) {
+            if (lv->dead) {
+                printk("Server 0x%04X is back\n", servers[srv].addr);
+            }
+            lv->dead   = false;
+            lv->misses = 0;
+            continue;
+        }
+
+        for (size_t i = 0; i < sensor_count; i++) {
+            if (sensor_table.server[i] == srv &&
+                sensor_table.state[i] != REQ_SKIPPED &&
+                sensor_table.state[i] != REQ_FAILED &&
+                sensor_table.state[i] != REQ_IDLE) {
+                asked = true;
+                break;
+            }
+        }
+
+        if (!asked || lv->dead) {
+            continue;
+        }
+
+        if (++lv->misses >= DEAD_AFTER_CYCLES) {
+            lv->dead          = true;
+            lv->next_probe_ms = now + PROBE_INTERVAL_MS;
+            printk("Server 0x%04X is down after %u silent cycles\n",
+                   servers[srv].addr, lv->misses);
+        }
+    }
+
+    k_spin_unlock(&req_lock, key);
+}
+
+static void hb_recv(const struct bt_mesh_hb_sub *sub, uint8_t hops, uint16_t feat)
+{
+    k_spinlock_key_t key = k_spin_lock(&req_lock);
+
+    for (size_t srv = 0; srv < server_count; srv++) {
+        if (servers[srv].addr == sub->src) {
+            liveness[srv].seen = true;
+            break;
+        }
+    }
+
+    k_spin_unlock(&req_lock, key);
+}
+
+BT_MESH_HB_CB_DEFINE(hb_cb) = {
+    .recv = hb_recv,
+};
+
+/* Passive mode's stand-in for the end of a cycle. A server that has not
+ * published anything for DEAD_AFTER_CYCLES reports in a row is down; there
+ * is nothing to probe it with, its next status brings it back.
+ */
+static void passive_report(uint32_t now)
+{
+    static uint32_t last_stats;
+    k_spinlock_key_t key = k_spin_lock(&req_lock);
+
+    for (size_t srv = 0; srv < server_count; srv++) {
+        liveness_t *lv = &liveness[srv];
+
+        if (lv->seen) {
+            if (lv->dead) {
+                printk("Server 0x%04X is back\n", servers[srv].addr);
+            }
+            lv->dead   = false;
+            lv->misses = 0;
+        } else if (!lv->dead && ++lv->misses >= DEAD_AFTER_CYCLES) {
+            lv->dead = true;
+            printk("Server 0x%04X is down after %u silent reports\n",
+                   servers[srv].addr, lv->misses);
+        }
+        lv->seen = false;
+    }
+
+    k_spin_unlock(&req_lock, key);
+
+    for (size_t srv = 0; srv < server_count; srv++) {
+        print_path(srv, now);
+    }
+
+    printk("PUB: forwarded=%u dup=%u unknown=%u\n",
+           passive_stats.forwarded, passive_stats.dup, passive_stats.unknown);
+
+    if (now - last_stats > STATS_INTERVAL_MS) {
+        last_stats = now;
+        stats_dump(NULL);
+    } else {
+        uart_line(NULL);
+    }
+}
+
+/* Send unicast GETs from *next_idx on while the window has room */
+static void send_unicast(size_t *next_idx)
+{
+    k_spinlock_key_t key;
+
+    while (*next_idx < sensor_count) {
+        size_t idx = *next_idx;
+        struct bt_mesh_msg_ctx ctx;
+        int err;
+
+        if (sensor_table.state[idx] != REQ_QUEUED) {
+            (*next_idx)++;
+            continue;
+        }
+
+        key = k_spin_lock(&req_lock);
+        if (outstanding >= GET_WINDOW) {
+            k_spin_unlock(&req_lock, key);
+            break;
+        }
+        sensor_table.state[idx]   = REQ_PENDING;
+        sensor_table.sent_ms[idx] = k_uptime_get_32();
+        outstanding++;
+        k_spin_unlock(&req_lock, key);
+
+        (*next_idx)++;
+
+        if (OUTPUT_TRACE) {
+            printk("Requesting %s (0x%04X) at addr 0x%04X\n",
+                   rec_name(idx),
+                   rec_type(idx)->id,
+                   sensor_table.addr[idx]);
+        }
+
+        rec_ctx(idx, &ctx);
+        err = bt_mesh_sensor_cli_get(&sensor_cli,
+                                     &ctx,
+                                     rec_type(idx),
+                                     NULL);
+        if (err) {
+            printk("GET %s at 0x%04X failed (err %d)\n",
+                   rec_name(idx), sensor_table.addr[idx], err);
+            key = k_spin_lock(&req_lock);
+            if (sensor_table.state[idx] == REQ_PENDING) {
+                sensor_table.state[idx] = REQ_FAILED;
+                outstanding--;
+            }
+            k_spin_unlock(&req_lock, key);
+            continue;
+        }
 
-#define RESPONSE_TIMEOUT_MS     5000
+        mode_stats[POLL_UNICAST].requests++;
+        count_tx(idx);
+    }
+}
+
+/*
+ * Send one group GET for poll_types[*next_idx] once the replies to the
+ * previous one are in. Every record of that type goes pending at once;
+ * the servers spread their statuses out with the access layer's random
+ * response delay, and each record still times out on its own.
+ */
+static void send_multicast(size_t *next_idx)
+{
+    struct bt_mesh_msg_ctx group_ctx = {
+        .net_idx  = NET_IDX,
+        .app_idx  = APP_IDX,
+        .addr     = POLL_GROUP_ADDR,
+        .send_ttl = DEFAULT_TTL,
+    };
+    k_spinlock_key_t key;
+
+    while (*next_idx < poll_type_count) {
+        uint8_t t = *next_idx;
+        const struct bt_mesh_sensor_type *type = poll_types[t];
+        uint32_t sent_ms = k_uptime_get_32();
+        uint32_t expected = 0;
+        int err;
+
+        key = k_spin_lock(&req_lock);
+        if (outstanding) {
+            k_spin_unlock(&req_lock, key);
+            break;
+        }
+        for (size_t i = 0; i < sensor_count; i++) {
+            if (sensor_table.type[i] == t && sensor_table.state[i] == REQ_QUEUED) {
+                sensor_table.state[i]   = REQ_PENDING;
+                sensor_table.sent_ms[i] = sent_ms;
+                outstanding++;
+                expected++;
+            }
+        }
+        k_spin_unlock(&req_lock, key);
+
+        (*next_idx)++;
+
+        /* No server has this type due */
+        if (!expected) {
+            continue;
+        }
+
+        if (OUTPUT_TRACE) {
+            printk("Requesting 0x%04X from group 0x%04X, %u replies expected\n",
+                   type->id, POLL_GROUP_ADDR, expected);
+        }
+
+        err = bt_mesh_sensor_cli_get(&sensor_cli, &group_ctx, type, NULL);
+
+        key = k_spin_lock(&req_lock);
+        for (size_t i = 0; i < sensor_count; i++) {
+            if (sensor_table.type[i] != t || sensor_table.state[i] != REQ_PENDING) {
+                continue;
+            }
+            if (err) {
+                sensor_table.state[i] = REQ_FAILED;
+                outstanding--;
+            } else {
+                count_tx(i);
+            }
+        }
+        k_spin_unlock(&req_lock, key);
+
+        if (err) {
+            printk("Group GET 0x%04X failed (err %d)\n", type->id, err);
+            continue;
+        }
+
+        mode_stats[POLL_MULTICAST].requests++;
+        return;
+    }
+}
+
+/*
+ * Send a property-less GET for the element of record *next_idx and
+ * mark all of its records pending. Records are sorted by address, so an
+ * element's records are next to each other. The window counts records,
+ * as each one is a value that has to come back.
+ */
+static void send_element(size_t *next_idx)
+{
+    k_spinlock_key_t key;
+
+    while (*next_idx < sensor_count) {
+        size_t first = *next_idx;
+        size_t end = first;
+        uint16_t addr = sensor_table.addr[first];
+        struct bt_mesh_msg_ctx ctx;
+        uint32_t sent_ms = k_uptime_get_32();
+        uint32_t asked = 0;
+        int err;
+
+        key = k_spin_lock(&req_lock);
+        if (outstanding >= GET_WINDOW) {
+            k_spin_unlock(&req_lock, key);
+            break;
+        }
+        while (end < sensor_count && sensor_table.addr[end] == addr) {
+            if (sensor_table.state[end] == REQ_QUEUED) {
+                sensor_table.state[end]   = REQ_PENDING;
+                sensor_table.sent_ms[end] = sent_ms;
+                outstanding++;
+                asked++;
+            }
+            end++;
+        }
+        k_spin_unlock(&req_lock, key);
+
+        *next_idx = end;
+
+        if (!asked) {
+            continue;
+        }
+
+        if (OUTPUT_TRACE) {
+            printk("Requesting all %u sensors at addr 0x%04X\n",
+                   asked, addr);
+        }
+
+        rec_ctx(first, &ctx);
+        err = bt_mesh_sensor_cli_all_get(&sensor_cli, &ctx, NULL, NULL);
+        if (err) {
+            printk("GET all at 0x%04X failed (err %d)\n", addr, err);
+            key = k_spin_lock(&req_lock);
+            for (size_t i = first; i < end; i++) {
+                if (sensor_table.state[i] == REQ_PENDING) {
+                    sensor_table.state[i] = REQ_FAILED;
+                    outstanding--;
+                }
+            }
+            k_spin_unlock(&req_lock, key);
+            continue;
+        }
 
+        mode_stats[POLL_ELEMENT].requests++;
+        key = k_spin_lock(&req_lock);
+        for (size_t i = first; i < end; i++) {
+            /* Asked now; a status may already have come in */
+            if ((sensor_table.state[i] == REQ_PENDING || sensor_table.state[i] == REQ_DONE) &&
+                sensor_table.sent_ms[i] == sent_ms) {
+                count_tx(i);
+            }
+        }
+        k_spin_unlock(&req_lock, key);
+    }
+}
 
+/* Re-send the GETs of records whose retry time has come, window allowing */
+static void send_retries(int mode, uint32_t now)
+{
+    k_spinlock_key_t key;
+
+    for (size_t i = 0; i < sensor_count; i++) {
+        struct bt_mesh_msg_ctx ctx;
+        int err;
+
+        key = k_spin_lock(&req_lock);
+        if (outstanding >= GET_WINDOW) {
+            k_spin_unlock(&req_lock, key);
+            break;
+        }
+        if (sensor_table.state[i] != REQ_RETRY ||
+            (int32_t)(sensor_table.retry_at[i] - now) > 0) {
+            k_spin_unlock(&req_lock, key);
+            continue;
+        }
+        sensor_table.state[i]   = REQ_PENDING;
+        sensor_table.sent_ms[i] = k_uptime_get_32();
+        retrying--;
+        outstanding++;
+        k_spin_unlock(&req_lock, key);
+
+        printk("Retry %u for %s at addr 0x%04X\n",
+               sensor_table.retries[i], rec_name(i), sensor_table.addr[i]);
+
+        rec_ctx(i, &ctx);
+        err = bt_mesh_sensor_cli_get(&sensor_cli, &ctx, rec_type(i), NULL);
+        if (err) {
+            key = k_spin_lock(&req_lock);
+            if (sensor_table.state[i] == REQ_PENDING) {
+                sensor_table.state[i] = REQ_FAILED;
+                outstanding--;
+            }
+            k_spin_unlock(&req_lock, key);
+            continue;
+        }
+
+        mode_stats[mode].retries++;
+        count_tx(i);
+    }
+}
+
+/*
+ * Schedule the next cycle for when the earliest (server, class) entry is due
+ */
+static void schedule_next(uint32_t now)
+{
+    int32_t wait = sched_next_in(now);
+
+    k_work_schedule(&get_data_work,
+                    K_MSEC(wait < 0 ? GET_DATA_INTERVAL : wait));
+}
+
+/*
+ * Pipelined polling. A cycle starts when the earliest scheduler entry is
+ * due, takes every (server, class) entry due by then, queues one GET per
+ * sensor behind them and keeps up to GET_WINDOW of them in flight. Each
+ * status frees its slot and kicks this work item, so the cycle moves at the
+ * speed of the replies and ends as soon as the last one is in. Every GET
+ * has its own deadline; an unanswered one times out without holding up the
+ * others. In multicast mode a cycle is one group GET per sensor type
+ * instead. The entries are re-armed one period on when the cycle ends.
+ * In passive mode there are no cycles, this only keeps the table current.
+ */
 static void get_data(struct k_work *work)
 {
     if (!bt_mesh_is_provisioned()) {
@@ -161,109 +1655,251 @@ static void get_data(struct k_work *work)
     }
 
     /* Persistent state across invocations */
-    static uint32_t server_idx;   /* which server in server_addrs[] */
-    static uint32_t sensor_idx;   /* which sensor in sensor_defs[] */
-    static bool     printing;     /* are we in the print phase? */
-
-    const size_t n_servers = ARRAY_SIZE(server_addrs);
-    const size_t n_sensors = ARRAY_SIZE(sensor_defs);
-
-    /* 1) POLLING PHASE */
-    if (!printing) {
-        /* first sensor of this server? clear flags & announce */
-        if (sensor_idx == 0) {
-            for (size_t s = 0; s < n_sensors; s++) {
-                size_t idx = server_idx * n_sensors + s;
-                sensor_table[idx].valid = false;
+    static size_t   next_idx;     /* next record, or type in multicast mode */
+    static bool     polling;      /* is a cycle in progress? */
+    static int      mode;         /* POLL_UNICAST, _MULTICAST or _ELEMENT */
+    static uint32_t retry_budget; /* retries left this cycle */
+    static uint32_t cycle_start;
+    static size_t   due_count;    /* entries taken for this cycle */
+
+    uint32_t now = k_uptime_get_32();
+    uint32_t next_deadline = REQUEST_TIMEOUT_MS;
+    k_spinlock_key_t key;
+
+    /* 1) START A CYCLE */
+    if (!polling) {
+        /* Do not claim servers before the other gateways are known, not
+         * even in discovery
+         */
+        if (!shard_ready()) {
+            k_work_schedule(&get_data_work,
+                            K_MSEC(GET_DATA_INTERVAL));
+            return;
+        }
+
+        if (!discovery_has_table()) {
+            /* Nothing to poll until the first sweep is done */
+            swept_shard_gen = shard_generation();
+            swept_plan_gen  = poll_plan_generation();
+            discovery_start();
+            k_work_schedule(&get_data_work,
+                            K_MSEC(GET_DATA_INTERVAL));
+            return;
+        }
+
+        /* Discovery only kept the servers that were ours */
+        if (shard_generation() != swept_shard_gen ||
+            poll_plan_generation() != swept_plan_gen) {
+            swept_shard_gen = shard_generation();
+            swept_plan_gen  = poll_plan_generation();
+            discovery_refilter();
+        }
+
+        /* Pick up a new discovery result, poll plan or set of gateways
+         * between cycles only
+         */
+        if (discovery_generation() != table_gen ||
+            poll_plan_generation() != plan_gen ||
+            shard_generation() != shard_gen) {
+            table_gen = discovery_generation();
+            plan_gen  = poll_plan_generation();
+            shard_gen = shard_generation();
+            load_sensor_table();
+            build_dispatch();
+            build_schedule();
+            if (INGEST_MODE == INGEST_POLL) {
+                k_work_reschedule(&series_work, K_MSEC(SERIES_DELAY_MS));
             }
-            printk("\n=== Requesting SERVER 0x%04X DATA ===\n",
-                   server_addrs[server_idx]);
         }
 
-        /* build ctx & send one GET */
-        {
-            size_t idx = server_idx * n_sensors + sensor_idx;
-            struct bt_mesh_msg_ctx *ctx = &sensor_table[idx].ctx;
+        /* Statuses come in on their own, only check on the table */
+        if (INGEST_MODE == INGEST_PASSIVE) {
+            static uint32_t last_report;
 
-            /* re-build ctx to point at this server’s element */
-            ctx->net_idx  = NET_IDX;
-            ctx->app_idx  = APP_IDX;
-            ctx->addr     = server_addrs[server_idx]
-                            + sensor_defs[sensor_idx].elem_offset;
-            ctx->send_ttl = DEFAULT_TTL;
+            if (now - last_report >= PASSIVE_REPORT_MS) {
+                last_report = now;
+                passive_report(now);
+            }
+            k_work_schedule(&get_data_work,
+                            K_MSEC(GET_DATA_INTERVAL));
+            return;
+        }
 
-            printk("Requesting %s (0x%04X) at addr 0x%04X\n",
-                   sensor_defs[sensor_idx].name,
-                   sensor_defs[sensor_idx].type->id,
-                   ctx->addr);
+        if (sched_next_in(now) != 0) {
+            schedule_next(now);
+            return;
+        }
 
-            bt_mesh_sensor_cli_get(&sensor_cli,
-                                   ctx,
-                                   sensor_defs[sensor_idx].type,
-                                   NULL);
+        key = k_spin_lock(&req_lock);
+        memset(sensor_table.state, REQ_IDLE, sensor_count);
+        memset(sensor_table.retries, 0, sensor_count);
+        due_count = 0;
+        for (struct sched_entry due; sched_pop_due(now, &due); due_count++) {
+            for (size_t i = 0; i < sensor_count; i++) {
+                if (sensor_table.server[i] == due.server &&
+                    sensor_table.group[i] == due.group) {
+                    sensor_table.state[i] = REQ_QUEUED;
+                }
+            }
         }
+        /* Every value in the table is from an earlier cycle now. When
+         * the stamps wrap, every value is re-stamped 1, older than any
+         * cycle from then on, so an old stamp cannot come round again and
+         * records not due keep their last value.
+         */
+        if (++cycle_gen == 0) {
+            for (size_t i = 0; i < sensor_count; i++) {
+                if (sensor_table.gen[i]) {
+                    sensor_table.gen[i] = 1;
+                }
+            }
+            cycle_gen = 2;
+        }
+        outstanding = 0;
+        retrying    = 0;
+        k_spin_unlock(&req_lock, key);
+
+        retry_budget = RETRY_BUDGET;
+        plan_cycle(now);
+
+        static uint32_t cycle;
+
+        next_idx    = 0;
+        polling     = true;
+        cycle_start = now;
+        mode        = (POLL_MODE == POLL_ALTERNATE) ? (cycle++ % POLL_MODES) : POLL_MODE;
+        printk("\n=== Requesting DATA for %u server classes (%s) ===\n",
+               (unsigned)due_count,
+               mode_names[mode]);
+    }
 
-        sensor_idx++;
+    /* 2) EXPIRE OVERDUE REQUESTS, QUEUE RETRIES FOR THEM */
+    key = k_spin_lock(&req_lock);
+    for (size_t i = 0; i < sensor_count; i++) {
+        uint8_t srv = sensor_table.server[i];
+        uint32_t age;
 
-        /* schedule next sensor GET, or the print phase */
-        if (sensor_idx < n_sensors) {
-            k_work_schedule(&get_data_work,
-                            K_MSEC(GET_DATA_INTERVAL_QUICK));
+        if (sensor_table.state[i] == REQ_RETRY) {
+            int32_t wait = sensor_table.retry_at[i] - now;
+
+            if (wait > 0) {
+                next_deadline = MIN(next_deadline, (uint32_t)wait);
+            }
+            continue;
+        }
+
+        if (sensor_table.state[i] != REQ_PENDING) {
+            continue;
+        }
+
+        age = now - sensor_table.sent_ms[i];
+        if (age < sensor_table.timeout_ms[i]) {
+            next_deadline = MIN(next_deadline, sensor_table.timeout_ms[i] - age);
+            continue;
+        }
+
+        outstanding--;
+        path_stats[srv].lost++;
+        count16(&sensor_stats[i].lost);
+
+        /* Probes of a down server get no retries, it gets another go later */
+        if (sensor_table.retries[i] < RETRY_MAX && retry_budget &&
+            !liveness[srv].dead) {
+            retry_budget--;
+            sensor_table.state[i]    = REQ_RETRY;
+            sensor_table.retry_at[i] = now + (RETRY_BACKOFF_MS << sensor_table.retries[i]);
+            sensor_table.retries[i]++;
+            retrying++;
+            next_deadline = MIN(next_deadline, RETRY_BACKOFF_MS << (sensor_table.retries[i] - 1));
         } else {
-            /* all GETs sent for this server—wait for responses */
-            printing = true;
-            k_work_schedule(&get_data_work,
-                            K_MSEC(RESPONSE_TIMEOUT_MS));
+            sensor_table.state[i] = REQ_TIMEOUT;
+            printk("Timeout %s at addr 0x%04X\n",
+                   rec_name(i), sensor_table.addr[i]);
         }
+    }
+    k_spin_unlock(&req_lock, key);
+
+    /* Missing readings go first, they have waited longest */
+    send_retries(mode, now);
+
+    /* 3) FILL THE WINDOW */
+    if (mode == POLL_MULTICAST) {
+        send_multicast(&next_idx);
+    } else if (mode == POLL_ELEMENT) {
+        send_element(&next_idx);
+    } else {
+        send_unicast(&next_idx);
+    }
 
+    /* 4) WAIT FOR REPLIES, OR FINISH THE CYCLE */
+    key = k_spin_lock(&req_lock);
+    bool done = (next_idx == (mode == POLL_MULTICAST ? poll_type_count : sensor_count) &&
+                 outstanding == 0 && retrying == 0);
+    k_spin_unlock(&req_lock, key);
+
+    if (!done) {
+        /* Statuses reschedule us immediately, this is the timeout path */
+        k_work_schedule(&get_data_work, K_MSEC(next_deadline));
         return;
     }
 
-    /* 2) PRINTING PHASE */
-    {
-        uint32_t now = k_uptime_get_32();
-        size_t   base = server_idx * n_sensors;
-
-        /* CSV header once, if you like—optional */
-        static uint32_t last_header;
-        if (now - last_header > 10000) {
-            printk("SERVER, timestamp_ms");
-            for (size_t s = 0; s < n_sensors; s++) {
-                printk(",%s", sensor_defs[s].name);
-            }
-            printk("\n");
-            last_header = now;
-        }
-
-        /* CSV data row for this server */
-        printk("0x%04X,%u",
-               server_addrs[server_idx],
-               (unsigned)now);
-        for (size_t s = 0; s < n_sensors; s++) {
-            size_t idx = base + s;
-            if (sensor_table[idx].valid) {
-                float vf = 0.0f;
-                bt_mesh_sensor_value_to_float(&sensor_table[idx].value,
-                                              &vf);
-                printk(",%.2f", (double)vf);
-            } else {
-                printk(","); /* blank on timeout */
-            }
+    /* 5) ACCOUNT LOSS FOR THIS MODE */
+    mode_stats[mode].cycles++;
+    for (size_t i = 0; i < sensor_count; i++) {
+        if (sensor_table.state[i] == REQ_FAILED ||
+            sensor_table.state[i] == REQ_SKIPPED ||
+            sensor_table.state[i] == REQ_IDLE) {
+            continue;
+        }
+        mode_stats[mode].expected++;
+        if (sensor_table.state[i] == REQ_DONE) {
+            mode_stats[mode].received++;
         }
-        printk("\n");
     }
 
-    /* 3) ADVANCE TO NEXT SERVER */
-    server_idx = (server_idx + 1) % n_servers;
-    sensor_idx = 0;
-    printing   = false;
+    now = k_uptime_get_32();
+    update_liveness(now);
 
-    /* schedule next server’s cycle */
-    k_work_schedule(&get_data_work,
-                    K_MSEC(GET_DATA_INTERVAL));
+    /* 6) RE-ARM THE ENTRIES POLLED THIS CYCLE */
+    sched_busy(now - cycle_start);
+    sched_done(now);
+    due_count = 0;
+
+    print_cycle();
+    polling = false;
+
+    schedule_next(now);
+}
+
+
+#if defined(CONFIG_SHELL)
+static int cmd_stats_show(const struct shell *sh, size_t argc, char **argv)
+{
+    stats_dump(sh);
+    return 0;
+}
+
+static int cmd_stats_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    k_spinlock_key_t key = k_spin_lock(&req_lock);
+
+    memset(path_stats, 0, sizeof(path_stats));
+    memset(sensor_stats, 0, sizeof(sensor_stats));
+    memset(&passive_stats, 0, sizeof(passive_stats));
+    k_spin_unlock(&req_lock, key);
+
+    shell_print(sh, "Statistics cleared");
+    return 0;
 }
 
+SHELL_STATIC_SUBCMD_SET_CREATE(stats_cmds,
+    SHELL_CMD(show, NULL, "RTT histograms per server, loss per server and sensor", cmd_stats_show),
+    SHELL_CMD(reset, NULL, "Clear the statistics", cmd_stats_reset),
+    SHELL_SUBCMD_SET_END
+);
 
+SHELL_CMD_REGISTER(stats, &stats_cmds, "Polling statistics", NULL);
+#endif
 
 static const int temp_ranges[][2] = {
 	{0, 100},
@@ -388,12 +2024,28 @@ static struct bt_mesh_health_srv health_srv = {
 
 BT_MESH_HEALTH_PUB_DEFINE(health_pub, 0);
 
+static void cfg_cli_comp_data_cb(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t page,
+				 struct net_buf_simple *buf)
+{
+	discovery_comp_data(addr, page, buf);
+}
+
+static const struct bt_mesh_cfg_cli_cb cfg_cli_cb = {
+	.comp_data = cfg_cli_comp_data_cb,
+};
+
+/* Composition Data Get for server discovery */
+static struct bt_mesh_cfg_cli cfg_cli = {
+	.cb = &cfg_cli_cb,
+};
+
 static struct bt_mesh_elem elements[] = {
 	BT_MESH_ELEM(1,
 		     BT_MESH_MODEL_LIST(BT_MESH_MODEL_CFG_SRV,
+					BT_MESH_MODEL_CFG_CLI(&cfg_cli),
 					BT_MESH_MODEL_HEALTH_SRV(&health_srv, &health_pub),
 					BT_MESH_MODEL_SENSOR_CLI(&sensor_cli)),
-		     BT_MESH_MODEL_NONE),
+		     BT_MESH_MODEL_LIST(SHARD_MODEL)),
 };
 
 static const struct bt_mesh_comp comp = {
@@ -407,11 +2059,14 @@ const struct bt_mesh_comp *model_handler_init(void)
 	k_work_init_delayable(&attention_blink_work, attention_blink);
 	k_work_init_delayable(&get_data_work, get_data);
 	k_work_init_delayable(&motion_timeout_work, motion_timeout);
+	k_work_init_delayable(&series_work, fetch_series);
 
 	dk_button_handler_add(&button_handler);
 	k_work_schedule(&get_data_work, K_MSEC(GET_DATA_INTERVAL));
 
-    init_sensor_table();
+    discovery_init(&sensor_cli);
+    discovery_set_filter(server_wanted);
+    series_init(&sensor_cli, OUTPUT_FORMAT == OUTPUT_BINARY);
 
 	return &comp;
 }
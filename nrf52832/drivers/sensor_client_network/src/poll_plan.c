@@ -0,0 +1,167 @@
+#include "poll_plan.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/printk.h>
+
+static struct poll_plan plan;
+static uint32_t generation;
+
+const struct poll_plan *poll_plan_get(void)
+{
+    return &plan;
+}
+
+uint32_t poll_plan_generation(void)
+{
+    return generation;
+}
+
+bool poll_plan_has_server(const struct poll_plan *p, uint16_t addr)
+{
+    if (!p->server_count) {
+        return true;
+    }
+
+    for (size_t i = 0; i < p->server_count; i++) {
+        if (p->servers[i] == addr) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const struct poll_plan_prop *poll_plan_prop(const struct poll_plan *p, uint16_t prop_id)
+{
+    for (size_t i = 0; i < p->prop_count; i++) {
+        if (p->props[i].prop_id == prop_id) {
+            return &p->props[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* See FRAME_TYPE_PLAN in frame.h for the layout */
+static int parse(const uint8_t *buf, size_t len, struct poll_plan *out)
+{
+    size_t pos;
+
+    memset(out, 0, sizeof(*out));
+
+    if (len < 4) {
+        return -EINVAL;
+    }
+    out->timeout_ms   = sys_get_le16(&buf[0]);
+    out->flags        = buf[2];
+    out->server_count = buf[3];
+    pos = 4;
+
+    if (out->server_count > POLL_PLAN_MAX_SERVERS ||
+        len < pos + 2 * out->server_count + 1) {
+        return -EINVAL;
+    }
+    for (size_t i = 0; i < out->server_count; i++) {
+        out->servers[i] = sys_get_le16(&buf[pos]);
+        pos += 2;
+    }
+
+    out->prop_count = buf[pos++];
+    if (out->prop_count > POLL_PLAN_MAX_PROPS ||
+        len != pos + 8 * out->prop_count) {
+        return -EINVAL;
+    }
+    for (size_t i = 0; i < out->prop_count; i++) {
+        out->props[i].prop_id    = sys_get_le16(&buf[pos]);
+        out->props[i].period_ms  = sys_get_le32(&buf[pos + 2]);
+        out->props[i].timeout_ms = sys_get_le16(&buf[pos + 6]);
+        pos += 8;
+    }
+
+    return 0;
+}
+
+int poll_plan_set(const uint8_t *payload, size_t len)
+{
+    struct poll_plan next;
+    int err;
+
+    err = parse(payload, len, &next);
+    if (err) {
+        return err;
+    }
+
+    plan = next;
+    generation++;
+
+    err = settings_save_one("plan/poll", &plan, sizeof(plan));
+    if (err) {
+        printk("Saving poll plan failed (err %d)\n", err);
+    }
+
+    return 0;
+}
+
+void poll_plan_reset(void)
+{
+    memset(&plan, 0, sizeof(plan));
+    generation++;
+    settings_delete("plan/poll");
+}
+
+void poll_plan_print(const struct poll_plan *p)
+{
+    printk("PLAN: timeout=%u ms flags=0x%02X servers=%u props=%u\n",
+           p->timeout_ms, p->flags, p->server_count, p->prop_count);
+
+    if (p->server_count) {
+        printk("PLAN servers:");
+        for (size_t i = 0; i < p->server_count; i++) {
+            printk(" 0x%04X", p->servers[i]);
+        }
+        printk("\n");
+    }
+
+    for (size_t i = 0; i < p->prop_count; i++) {
+        printk("PLAN prop 0x%04X: period=%u ms timeout=%u ms\n",
+               p->props[i].prop_id, p->props[i].period_ms, p->props[i].timeout_ms);
+    }
+}
+
+static int plan_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+                             void *cb_arg)
+{
+    const char *next;
+    struct poll_plan stored;
+    ssize_t rc;
+
+    if (!settings_name_steq(name, "poll", &next) || next) {
+        return -ENOENT;
+    }
+
+    /* Saved by a build with another layout, start from the empty plan */
+    if (len != sizeof(stored)) {
+        return -EINVAL;
+    }
+
+    rc = read_cb(cb_arg, &stored, len);
+    if (rc < 0) {
+        return rc;
+    }
+
+    if (stored.server_count > POLL_PLAN_MAX_SERVERS ||
+        stored.prop_count > POLL_PLAN_MAX_PROPS) {
+        return -EINVAL;
+    }
+
+    plan = stored;
+    generation++;
+    printk("Restored poll plan: %u servers, %u props\n",
+           plan.server_count, plan.prop_count);
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(poll_plan, "plan", NULL, plan_settings_set, NULL, NULL);
@@ -0,0 +1,60 @@
+#include "rtt_hist.h"
+#include <zephyr/sys/util.h>
+
+/* Bucket 1 starts at 2^RTT_HIST_SHIFT ms */
+#define RTT_HIST_SHIFT 4
+
+static int bucket_of(uint32_t rtt_ms)
+{
+    int log2;
+
+    if (rtt_ms < BIT(RTT_HIST_SHIFT)) {
+        return 0;
+    }
+
+    log2 = 31 - __builtin_clz(rtt_ms);
+    return MIN(log2 - RTT_HIST_SHIFT + 1, RTT_HIST_BUCKETS - 1);
+}
+
+void rtt_hist_add(struct rtt_hist *hist, uint32_t rtt_ms)
+{
+    int b = bucket_of(rtt_ms);
+
+    if (hist->bucket[b] < UINT16_MAX) {
+        hist->bucket[b]++;
+    }
+    hist->count++;
+    hist->sum_ms += rtt_ms;
+    hist->max_ms = MAX(hist->max_ms, rtt_ms);
+}
+
+uint32_t rtt_hist_bucket_floor(int b)
+{
+    return b ? BIT(b + RTT_HIST_SHIFT - 1) : 0;
+}
+
+uint32_t rtt_hist_percentile(const struct rtt_hist *hist, unsigned int pct)
+{
+    uint32_t total = 0;
+    uint32_t rank;
+    uint32_t seen = 0;
+
+    /* Use the bucket sums rather than count, they may have saturated */
+    for (int b = 0; b < RTT_HIST_BUCKETS; b++) {
+        total += hist->bucket[b];
+    }
+    if (!total) {
+        return 0;
+    }
+
+    rank = DIV_ROUND_UP(total * pct, 100);
+
+    for (int b = 0; b < RTT_HIST_BUCKETS - 1; b++) {
+        seen += hist->bucket[b];
+        if (seen >= rank) {
+            return rtt_hist_bucket_floor(b + 1) - 1;
+        }
+    }
+
+    return hist->max_ms;
+}
@@ -0,0 +1,151 @@
+#include "sched.h"
+#include <errno.h>
+#include <zephyr/sys/util.h>
+
+/* The heap is heap[0 .. heap_len). Entries popped since the last
+ * sched_done() are parked right after it, in heap[heap_len .. heap_len +
+ * parked), so they need no room of their own.
+ */
+static struct sched_entry heap[SCHED_MAX_ENTRIES];
+static size_t heap_len;
+static size_t parked;
+static struct sched_stats stats;
+
+/* Deadlines wrap with the 32-bit uptime, so compare differences */
+static inline bool before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+static void swap(size_t a, size_t b)
+{
+    struct sched_entry tmp = heap[a];
+
+    heap[a] = heap[b];
+    heap[b] = tmp;
+}
+
+static void sift_up(size_t i)
+{
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+
+        if (!before(heap[i].deadline_ms, heap[parent].deadline_ms)) {
+            break;
+        }
+        swap(i, parent);
+        i = parent;
+    }
+}
+
+static void sift_down(size_t i)
+{
+    for (;;) {
+        size_t l = 2 * i + 1;
+        size_t r = l + 1;
+        size_t min = i;
+
+        if (l < heap_len && before(heap[l].deadline_ms, heap[min].deadline_ms)) {
+            min = l;
+        }
+        if (r < heap_len && before(heap[r].deadline_ms, heap[min].deadline_ms)) {
+            min = r;
+        }
+        if (min == i) {
+            break;
+        }
+        swap(i, min);
+        i = min;
+    }
+}
+
+static int push(const struct sched_entry *entry)
+{
+    if (heap_len + parked == SCHED_MAX_ENTRIES) {
+        return -ENOMEM;
+    }
+
+    /* Move the first parked entry out of the way */
+    heap[heap_len + parked] = heap[heap_len];
+    heap[heap_len] = *entry;
+    sift_up(heap_len++);
+    return 0;
+}
+
+void sched_reset(uint32_t now)
+{
+    heap_len = 0;
+    parked = 0;
+    stats = (struct sched_stats){ .since_ms = now };
+}
+
+int sched_add(uint8_t server, uint8_t group, uint32_t period_ms, uint32_t first_ms)
+{
+    struct sched_entry entry = {
+        .deadline_ms = first_ms,
+        .period_ms = period_ms,
+        .server = server,
+        .group = group,
+    };
+
+    return push(&entry);
+}
+
+bool sched_pop_due(uint32_t now, struct sched_entry *out)
+{
+    uint32_t late;
+
+    if (!heap_len || before(now, heap[0].deadline_ms)) {
+        return false;
+    }
+
+    *out = heap[0];
+    swap(0, --heap_len);
+    parked++;
+    sift_down(0);
+
+    late = now - out->deadline_ms;
+    stats.dispatched++;
+    stats.late_sum_ms += late;
+    stats.late_max_ms = MAX(stats.late_max_ms, late);
+    return true;
+}
+
+void sched_done(uint32_t now)
+{
+    for (; parked; parked--) {
+        struct sched_entry *entry = &heap[heap_len];
+
+        entry->deadline_ms += entry->period_ms;
+
+        if (!before(now, entry->deadline_ms)) {
+            stats.overruns += (now - entry->deadline_ms) / entry->period_ms + 1;
+            entry->deadline_ms = now + entry->period_ms;
+        }
+
+        sift_up(heap_len++);
+    }
+}
+
+int32_t sched_next_in(uint32_t now)
+{
+    if (!heap_len) {
+        return -1;
+    }
+
+    if (!before(now, heap[0].deadline_ms)) {
+        return 0;
+    }
+
+    return heap[0].deadline_ms - now;
+}
+
+void sched_busy(uint32_t ms)
+{
+    stats.busy_ms += ms;
+}
+
+const struct sched_stats *sched_stats_get(void)
+{
+    return &stats;
+}
@@ -0,0 +1,247 @@
+#include "series.h"
+#include "frame.h"
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+struct fetch {
+    uint16_t addr;
+    const struct bt_mesh_sensor_type *type;
+    struct bt_mesh_sensor_column range;
+    bool has_range;
+};
+
+static struct bt_mesh_sensor_cli *sensor_cli;
+static bool binary_out;
+static struct k_work_delayable fetch_work;
+static struct k_spinlock lock;
+
+static struct fetch queue[SERIES_QUEUE_LEN];
+static size_t head;
+static size_t queued;
+
+/* The fetch waiting for its status */
+static struct fetch current;
+static bool busy;
+static uint32_t sent_ms;
+
+/* Frame being filled from the status coming in. Statuses are handled one
+ * at a time, all entries in a row, so one is enough.
+ */
+static struct frame frame;
+static size_t count_at;
+static uint8_t in_frame;
+
+static bool same_fetch(const struct fetch *a, uint16_t addr,
+                       const struct bt_mesh_sensor_type *type)
+{
+    return a->addr == addr && a->type == type;
+}
+
+static void fetch_next(struct k_work *work)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx  = 0,
+        .app_idx  = 0,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+    uint32_t now = k_uptime_get_32();
+    struct fetch expired = { 0 };
+    struct fetch next;
+    bool send = false;
+    k_spinlock_key_t key;
+    int err;
+
+    key = k_spin_lock(&lock);
+
+    if (busy) {
+        int32_t left = SERIES_TIMEOUT_MS - (int32_t)(now - sent_ms);
+
+        if (left > 0) {
+            k_spin_unlock(&lock, key);
+            k_work_schedule(&fetch_work, K_MSEC(left));
+            return;
+        }
+        expired = current;
+        busy = false;
+    }
+
+    if (queued) {
+        next = queue[head];
+        head = (head + 1) % SERIES_QUEUE_LEN;
+        queued--;
+        current = next;
+        busy = true;
+        sent_ms = now;
+        send = true;
+    }
+
+    k_spin_unlock(&lock, key);
+
+    if (expired.type) {
+        printk("Series 0x%04X at 0x%04X timed out\n", expired.type->id, expired.addr);
+    }
+
+    if (!send) {
+        return;
+    }
+
+    printk("Requesting series 0x%04X at 0x%04X\n", next.type->id, next.addr);
+
+    ctx.addr = next.addr;
+    err = bt_mesh_sensor_cli_series_entries_get(sensor_cli, &ctx, next.type,
+                                                next.has_range ? &next.range : NULL,
+                                                NULL, NULL);
+    if (err) {
+        printk("Series GET 0x%04X at 0x%04X failed (err %d)\n", next.type->id, next.addr, err);
+        key = k_spin_lock(&lock);
+        busy = false;
+        k_spin_unlock(&lock, key);
+        k_work_reschedule(&fetch_work, K_NO_WAIT);
+        return;
+    }
+
+    k_work_schedule(&fetch_work, K_MSEC(SERIES_TIMEOUT_MS));
+}
+
+void series_init(struct bt_mesh_sensor_cli *cli, bool binary)
+{
+    sensor_cli = cli;
+    binary_out = binary;
+    k_work_init_delayable(&fetch_work, fetch_next);
+}
+
+int series_fetch(uint16_t addr, const struct bt_mesh_sensor_type *type,
+                 const struct bt_mesh_sensor_column *range)
+{
+    k_spinlock_key_t key;
+    struct fetch *f;
+
+    if (!(type->flags & BT_MESH_SENSOR_TYPE_FLAG_SERIES)) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&lock);
+
+    if (busy && same_fetch(&current, addr, type)) {
+        k_spin_unlock(&lock, key);
+        return -EALREADY;
+    }
+    for (size_t i = 0; i < queued; i++) {
+        if (same_fetch(&queue[(head + i) % SERIES_QUEUE_LEN], addr, type)) {
+            k_spin_unlock(&lock, key);
+            return -EALREADY;
+        }
+    }
+
+    if (queued == SERIES_QUEUE_LEN) {
+        k_spin_unlock(&lock, key);
+        return -ENOMEM;
+    }
+
+    f = &queue[(head + queued++) % SERIES_QUEUE_LEN];
+    f->addr = addr;
+    f->type = type;
+    f->has_range = range != NULL;
+    if (range) {
+        f->range = *range;
+    }
+
+    k_spin_unlock(&lock, key);
+
+    /* Leaves a pending timeout alone */
+    k_work_schedule(&fetch_work, K_NO_WAIT);
+    return 0;
+}
+
+static void flush_frame(void)
+{
+    if (in_frame) {
+        frame.buf[count_at] = in_frame;
+        frame_send(&frame);
+        in_frame = 0;
+    }
+}
+
+/* One entry into the current FRAME_TYPE_SERIES frame, see frame.h */
+static void put_entry(uint16_t addr, const struct bt_mesh_sensor_type *type,
+                      uint8_t index, uint8_t count,
+                      const struct bt_mesh_sensor_series_entry *entry)
+{
+    size_t len = 2;
+
+    for (int ch = 0; ch < type->channel_count; ch++) {
+        len += 1 + entry->value[ch].format->size;
+    }
+
+    if (in_frame && frame_room(&frame) < len) {
+        flush_frame();
+    }
+
+    if (!in_frame) {
+        frame_begin(&frame, FRAME_TYPE_SERIES, k_uptime_get_32());
+        frame_put_le16(&frame, addr);
+        frame_put_le16(&frame, type->id);
+        frame_put_u8(&frame, count);
+        count_at = frame.len;
+        frame_put_u8(&frame, 0);
+    }
+
+    frame_put_u8(&frame, index);
+    frame_put_u8(&frame, type->channel_count);
+    for (int ch = 0; ch < type->channel_count; ch++) {
+        const struct bt_mesh_sensor_value *val = &entry->value[ch];
+
+        frame_put_u8(&frame, val->format->size);
+        frame_put_bytes(&frame, val->raw, val->format->size);
+    }
+    in_frame++;
+}
+
+static void print_entry(uint16_t addr, const struct bt_mesh_sensor_type *type,
+                        uint8_t index, uint8_t count,
+                        const struct bt_mesh_sensor_series_entry *entry)
+{
+    printk("SERIES 0x%04X,0x%04X,%u,%u,%u", addr, type->id, k_uptime_get_32(), index, count);
+    for (int ch = 0; ch < type->channel_count; ch++) {
+        printk(",%s", bt_mesh_sensor_ch_str(&entry->value[ch]));
+    }
+    printk("\n");
+}
+
+void series_entry(struct bt_mesh_msg_ctx *ctx, const struct bt_mesh_sensor_type *type,
+                  uint8_t index, uint8_t count,
+                  const struct bt_mesh_sensor_series_entry *entry)
+{
+    bool last = (index + 1 >= count);
+    k_spinlock_key_t key;
+    bool done = false;
+
+    /* Published statuses and the buttons' GETs come out here too */
+    if (binary_out) {
+        if (!index) {
+            flush_frame();
+        }
+        put_entry(ctx->addr, type, index, count, entry);
+        if (last) {
+            flush_frame();
+        }
+    } else {
+        print_entry(ctx->addr, type, index, count, entry);
+    }
+
+    if (!last) {
+        return;
+    }
+
+    key = k_spin_lock(&lock);
+    if (busy && same_fetch(&current, ctx->addr, type)) {
+        busy = false;
+        done = true;
+    }
+    k_spin_unlock(&lock, key);
+
+    if (done) {
+        k_work_reschedule(&fetch_work, K_NO_WAIT);
+    }
+}
@@ -0,0 +1,253 @@
+#include "shard.h"
+#include <zephyr/kernel.h>
+#include <zephyr/random/random.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/printk.h>
+
+/* Beacon payload: servers polled, le16 */
+#define SHARD_BEACON_LEN        2
+
+/* Time after the first beacon before the gateway claims its shard. The
+ * peers answer a beacon from a gateway they did not know within
+ * SHARD_REPLY_MAX_MS.
+ */
+#define SHARD_LISTEN_MS         3000
+#define SHARD_REPLY_MAX_MS      1000
+
+/* Retry interval while the gateway itself is not provisioned */
+#define SHARD_RETRY_MS          5000
+
+struct peer {
+    uint16_t addr;
+    uint16_t servers;
+    uint32_t seen_ms;
+};
+
+static const struct bt_mesh_model *shard_mod;
+static struct k_work_delayable beacon_work;
+static struct k_spinlock lock;
+
+static struct peer peers[SHARD_MAX_GATEWAYS - 1];
+static size_t peer_count;
+static uint16_t own_addr;
+static uint16_t own_servers;
+static uint32_t ready_at;
+static bool started;
+static uint32_t generation;
+
+/* murmur3's finaliser over both addresses, so that every gateway gets an
+ * unrelated ranking of the servers
+ */
+static uint32_t shard_weight(uint16_t server, uint16_t gateway)
+{
+    uint32_t h = ((uint32_t)server << 16) | gateway;
+
+    h ^= h >> 16;
+    h *= 0x85EBCA6BU;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35U;
+    h ^= h >> 16;
+    return h;
+}
+
+bool shard_owns(uint16_t server)
+{
+    k_spinlock_key_t key;
+    uint32_t own;
+    bool owns = true;
+
+    if (!own_addr) {
+        return true;
+    }
+
+    own = shard_weight(server, own_addr);
+
+    key = k_spin_lock(&lock);
+    for (size_t i = 0; i < peer_count; i++) {
+        uint32_t w = shard_weight(server, peers[i].addr);
+
+        /* Ties go to the lower address */
+        if (w > own || (w == own && peers[i].addr < own_addr)) {
+            owns = false;
+            break;
+        }
+    }
+    k_spin_unlock(&lock, key);
+
+    return owns;
+}
+
+bool shard_ready(void)
+{
+    return started && (int32_t)(k_uptime_get_32() - ready_at) >= 0;
+}
+
+uint32_t shard_generation(void)
+{
+    return generation;
+}
+
+void shard_set_polled(uint16_t servers)
+{
+    own_servers = servers;
+}
+
+void shard_print(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t now = k_uptime_get_32();
+
+    printk("SHARD: gateway 0x%04X polls %u servers, %u peers\n",
+           own_addr, own_servers, (unsigned)peer_count);
+    for (size_t i = 0; i < peer_count; i++) {
+        printk("SHARD peer 0x%04X: %u servers, seen %u ms ago\n",
+               peers[i].addr, peers[i].servers, now - peers[i].seen_ms);
+    }
+
+    k_spin_unlock(&lock, key);
+}
+
+static void send_beacon(void)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx  = 0,
+        .app_idx  = 0,
+        .addr     = SHARD_GROUP_ADDR,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+    int err;
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, SHARD_OP_BEACON, SHARD_BEACON_LEN);
+    bt_mesh_model_msg_init(&msg, SHARD_OP_BEACON);
+    net_buf_simple_add_le16(&msg, own_servers);
+
+    err = bt_mesh_model_send(shard_mod, &ctx, &msg, NULL, NULL);
+    if (err) {
+        printk("Shard beacon failed (err %d)\n", err);
+    }
+}
+
+/* Drop the peers not heard from in time. Call with lock held. */
+static bool expire_peers(uint32_t now)
+{
+    bool changed = false;
+
+    for (size_t i = 0; i < peer_count;) {
+        if (now - peers[i].seen_ms < SHARD_PEER_TIMEOUT_MS) {
+            i++;
+            continue;
+        }
+
+        printk("Gateway 0x%04X is gone, taking over its servers\n", peers[i].addr);
+        peers[i] = peers[--peer_count];
+        changed = true;
+    }
+
+    return changed;
+}
+
+static void beacon(struct k_work *work)
+{
+    uint32_t now = k_uptime_get_32();
+    k_spinlock_key_t key;
+
+    if (!bt_mesh_is_provisioned()) {
+        k_work_schedule(&beacon_work, K_MSEC(SHARD_RETRY_MS));
+        return;
+    }
+
+    if (!started) {
+        own_addr = bt_mesh_model_elem(shard_mod)->rt->addr;
+        ready_at = now + SHARD_LISTEN_MS;
+        started  = true;
+    }
+
+    send_beacon();
+
+    key = k_spin_lock(&lock);
+    if (expire_peers(now)) {
+        generation++;
+    }
+    k_spin_unlock(&lock, key);
+
+    k_work_schedule(&beacon_work, K_MSEC(SHARD_BEACON_MS));
+}
+
+static int handle_beacon(const struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+                         struct net_buf_simple *buf)
+{
+    uint16_t servers = net_buf_simple_pull_le16(buf);
+    uint32_t now = k_uptime_get_32();
+    k_spinlock_key_t key;
+    bool joined = false;
+    size_t i;
+
+    /* Our own, looped back through the group subscription */
+    if (ctx->addr == own_addr || !BT_MESH_ADDR_IS_UNICAST(ctx->addr)) {
+        return 0;
+    }
+
+    key = k_spin_lock(&lock);
+
+    for (i = 0; i < peer_count; i++) {
+        if (peers[i].addr == ctx->addr) {
+            break;
+        }
+    }
+
+    if (i == peer_count) {
+        if (peer_count == ARRAY_SIZE(peers)) {
+            k_spin_unlock(&lock, key);
+            printk("Gateway 0x%04X ignored, %u gateways at most\n",
+                   ctx->addr, SHARD_MAX_GATEWAYS);
+            return 0;
+        }
+        peers[peer_count++].addr = ctx->addr;
+        generation++;
+        joined = true;
+    }
+
+    peers[i].servers = servers;
+    peers[i].seen_ms = now;
+
+    k_spin_unlock(&lock, key);
+
+    if (joined) {
+        printk("Gateway 0x%04X joined, %u gateways\n",
+               ctx->addr, (unsigned)peer_count + 1);
+
+        /* Let it know about us before its listening time is up. Spread
+         * out, as every other gateway answers it too.
+         */
+        if (started) {
+            k_work_reschedule(&beacon_work,
+                              K_MSEC(sys_rand32_get() % SHARD_REPLY_MAX_MS));
+        }
+    }
+
+    return 0;
+}
+
+const struct bt_mesh_model_op _shard_op[] = {
+    { SHARD_OP_BEACON, BT_MESH_LEN_EXACT(SHARD_BEACON_LEN), handle_beacon },
+    BT_MESH_MODEL_OP_END,
+};
+
+static int shard_init(const struct bt_mesh_model *model)
+{
+    shard_mod = model;
+    k_work_init_delayable(&beacon_work, beacon);
+    return 0;
+}
+
+/* After settings are loaded, so the address is known if provisioned */
+static int shard_start(const struct bt_mesh_model *model)
+{
+    k_work_schedule(&beacon_work, K_NO_WAIT);
+    return 0;
+}
+
+const struct bt_mesh_model_cb _shard_cb = {
+    .init  = shard_init,
+    .start = shard_start,
+};
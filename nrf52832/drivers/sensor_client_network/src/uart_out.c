@@ -0,0 +1,242 @@
+#include "uart_out.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/printk-hooks.h>
+#include <zephyr/sys/ring_buffer.h>
+
+static const struct device *const uart = DEVICE_DT_GET(DT_CHOSEN(zephyr_console));
+
+/* The ring memory is what EasyDMA reads from, so it has to be in RAM,
+ * which a static buffer is.
+ */
+RING_BUF_DECLARE(tx_ring, UART_OUT_BUF_SIZE);
+
+/* Writers take put_lock, so to the ring there is a single producer. The
+ * consumer side is only touched by whoever holds tx_busy: the writer that
+ * found the UART idle, then the TX done interrupt.
+ */
+static struct k_spinlock put_lock;
+static atomic_t tx_busy;
+static bool ready;
+
+static struct uart_out_stats stats;
+
+/* RX is double buffered by the driver; a buffer is handed back once the
+ * line assembler has gone through it. Bytes are flushed to us after
+ * RX_TIMEOUT_US of silence, so a line does not wait for a full buffer.
+ */
+#define RX_BUF_SIZE     32
+#define RX_TIMEOUT_US   10000
+
+static uint8_t rx_buf[2][RX_BUF_SIZE];
+static uint8_t rx_next;
+
+/* A line, or a frame after a 0x00 until the next one */
+static uint8_t rx_data[UART_OUT_FRAME_MAX];
+static size_t rx_len;
+static bool rx_overlong;
+static bool rx_in_frame;
+
+/* What is being handled on the workqueue, owned by it while rx_busy */
+static uint8_t rx_msg[UART_OUT_FRAME_MAX];
+static size_t rx_msg_len;
+static bool rx_msg_frame;
+static atomic_t rx_busy;
+static uart_out_line_cb_t line_cb;
+static uart_out_frame_cb_t frame_cb;
+
+static void rx_handler(struct k_work *work)
+{
+    if (rx_msg_frame) {
+        frame_cb(rx_msg, rx_msg_len);
+    } else {
+        line_cb((char *)rx_msg);
+    }
+    atomic_clear(&rx_busy);
+}
+
+static K_WORK_DEFINE(rx_work, rx_handler);
+
+static void tx_start(void)
+{
+    uint8_t *data;
+    uint32_t len;
+
+    for (;;) {
+        len = ring_buf_get_claim(&tx_ring, &data, UART_OUT_BUF_SIZE);
+        if (len) {
+            if (uart_tx(uart, data, len, SYS_FOREVER_US) == 0) {
+                return;
+            }
+            /* Should not happen while we own the UART, drop the chunk */
+            ring_buf_get_finish(&tx_ring, len);
+            continue;
+        }
+
+        atomic_clear(&tx_busy);
+
+        /* A writer may have queued something after the claim above but
+         * seen tx_busy still set, pick that up.
+         */
+        if (ring_buf_is_empty(&tx_ring) || !atomic_cas(&tx_busy, 0, 1)) {
+            return;
+        }
+    }
+}
+
+/* Hand the line or frame in rx_data over to the workqueue */
+static void rx_submit(bool frame)
+{
+    if (rx_overlong || !atomic_cas(&rx_busy, 0, 1)) {
+        stats.dropped_lines++;
+        return;
+    }
+
+    memcpy(rx_msg, rx_data, rx_len);
+    rx_msg_len = rx_len;
+    rx_msg_frame = frame;
+    if (!frame) {
+        rx_msg[rx_len] = '\0';
+    }
+    k_work_submit(&rx_work);
+}
+
+static void rx_byte(uint8_t c)
+{
+    size_t max = rx_in_frame ? sizeof(rx_data) : UART_OUT_LINE_MAX - 1;
+
+    if (c == 0x00) {
+        /* Closes a frame, or opens one and cuts off a partial line.
+         * Back to back delimiters just open the frame again.
+         */
+        if (rx_in_frame && rx_len) {
+            rx_submit(true);
+            rx_in_frame = false;
+        } else {
+            rx_in_frame = true;
+        }
+    } else if (rx_in_frame || (c != '\r' && c != '\n')) {
+        if (rx_len < max) {
+            rx_data[rx_len++] = c;
+        } else {
+            rx_overlong = true;
+        }
+        return;
+    } else if (rx_len) {
+        rx_submit(false);
+    }
+
+    rx_len = 0;
+    rx_overlong = false;
+}
+
+static int rx_restart(void)
+{
+    rx_next = 1;
+    return uart_rx_enable(uart, rx_buf[0], RX_BUF_SIZE, RX_TIMEOUT_US);
+}
+
+static void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
+{
+    k_spinlock_key_t key;
+
+    switch (evt->type) {
+    case UART_TX_DONE:
+    case UART_TX_ABORTED:
+        key = k_spin_lock(&put_lock);
+        stats.bytes += evt->data.tx.len;
+        k_spin_unlock(&put_lock, key);
+
+        ring_buf_get_finish(&tx_ring, evt->data.tx.len);
+        tx_start();
+        break;
+    case UART_RX_RDY:
+        for (size_t i = 0; i < evt->data.rx.len; i++) {
+            rx_byte(evt->data.rx.buf[evt->data.rx.offset + i]);
+        }
+        break;
+    case UART_RX_BUF_REQUEST:
+        uart_rx_buf_rsp(uart, rx_buf[rx_next], RX_BUF_SIZE);
+        rx_next ^= 1;
+        break;
+    case UART_RX_DISABLED:
+        /* Line break or framing error, carry on listening */
+        rx_restart();
+        break;
+    default:
+        break;
+    }
+}
+
+int uart_out_write(const void *data, size_t len)
+{
+    k_spinlock_key_t key = k_spin_lock(&put_lock);
+    uint32_t queued;
+
+    if (ring_buf_space_get(&tx_ring) < len) {
+        stats.dropped_bytes += len;
+        stats.dropped_writes++;
+        k_spin_unlock(&put_lock, key);
+        return -ENOBUFS;
+    }
+
+    ring_buf_put(&tx_ring, data, len);
+    queued = ring_buf_size_get(&tx_ring);
+    stats.high_water = MAX(stats.high_water, queued);
+    k_spin_unlock(&put_lock, key);
+
+    if (ready && atomic_cas(&tx_busy, 0, 1)) {
+        tx_start();
+    }
+
+    return 0;
+}
+
+static int printk_out(int c)
+{
+    uint8_t ch = c;
+
+    uart_out_write(&ch, 1);
+    return c;
+}
+
+int uart_out_rx_start(uart_out_line_cb_t on_line, uart_out_frame_cb_t on_frame)
+{
+    if (!ready) {
+        return -ENODEV;
+    }
+
+    line_cb = on_line;
+    frame_cb = on_frame;
+    return rx_restart();
+}
+
+void uart_out_stats_get(struct uart_out_stats *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&put_lock);
+
+    *out = stats;
+    k_spin_unlock(&put_lock, key);
+}
+
+int uart_out_init(void)
+{
+    int err;
+
+    if (!device_is_ready(uart)) {
+        return -ENODEV;
+    }
+
+    err = uart_callback_set(uart, uart_cb, NULL);
+    if (err) {
+        return err;
+    }
+
+    ready = true;
+    __printk_hook_install(printk_out);
+    return 0;
+}
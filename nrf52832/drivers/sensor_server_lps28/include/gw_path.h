@@ -0,0 +1,47 @@
+#ifndef _GW_PATH_H_
+#define _GW_PATH_H_
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * TTL the gateway (sensor_client_network) puts on every request.
+ * Must match DEFAULT_TTL in the client so the hop count can be
+ * recovered from the received TTL.
+ */
+#define GW_PATH_REQUEST_TTL 7
+
+/*
+ * Extra hops allowed on the way back to the gateway, in case the
+ * return path is not the mirror image of the request path.
+ */
+#define GW_PATH_TTL_MARGIN 1
+
+/*
+ * Learn the hop distance to the gateway from an incoming request and
+ * scope the response in *ctx to that distance, so the status is only
+ * relayed as far as the gateway instead of flooding the whole network.
+ * Safe to call with ctx == NULL (periodic publication).
+ */
+void gw_path_scope(struct bt_mesh_msg_ctx *ctx);
+
+/*
+ * Address of the gateway the path was learned from, or
+ * BT_MESH_ADDR_UNASSIGNED if no request has been seen yet.
+ */
+uint16_t gw_path_addr(void);
+
+/*
+ * Hop count to the gateway, or 0 if unknown.
+ */
+uint8_t gw_path_hops(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _GW_PATH_H_ */
@@ -0,0 +1,84 @@
+#ifndef _HX711_H_
+#define _HX711_H_
+
+#include <zephyr/types.h>
+#include <zephyr/devicetree.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * HX711 load cell amplifiers, bit-banged over GPIOs taken from the
+ * zephyr,user node in the board overlay:
+ *
+ *   hx711-dout-gpios  one DOUT per load cell, also the data-ready lines
+ *   hx711-sck-gpios   PD_SCK, shared by all HX711s
+ *
+ * All amplifiers are clocked together from the shared PD_SCK and every
+ * DOUT is sampled with a single port read per clock edge, so N scales
+ * are read in the time of one and their readings are latched on the
+ * same edges. This needs all DOUT pins and PD_SCK on the same GPIO port.
+ *
+ * A read starts from the DRDY interrupt once every DOUT is low, so the
+ * node keeps a filtered reading at the HX711 output rate (10 SPS with
+ * RATE tied low) without polling. Channel A, gain 128. A channel whose
+ * DOUT stays high for more than two conversion periods is dropped, and
+ * the others carry on without it.
+ */
+
+/* Number of load cells wired up in the devicetree */
+#define HX711_CHANNELS DT_PROP_LEN_OR(DT_PATH(zephyr_user), hx711_dout_gpios, 0)
+
+/* Readings averaged into the reported value (like read_average(16)
+ * in rpi5/drivers/hx711.py)
+ */
+#define HX711_AVG_SAMPLES 16
+
+/*
+ * Configure the GPIOs and the DRDY interrupt and power up the chips.
+ * Returns 0 on success, or a negative error code.
+ */
+int hx711_init(void);
+
+/*
+ * Latest averaged raw reading (signed 24-bit counts) of channel ch.
+ * Returns 0 on success, -EINVAL for a bad channel, -ENODATA if the
+ * channel was dropped for not converting, or -EAGAIN until the first
+ * full average.
+ */
+int hx711_raw_get(uint8_t ch, int32_t *raw);
+
+/*
+ * Latest averaged reading of channel ch converted to grams with the
+ * stored calibration: grams = (raw - offset) / scale.
+ * Returns 0 on success, -ENODATA if the channel has not been calibrated,
+ * or a negative error code as hx711_raw_get().
+ */
+int hx711_grams_get(uint8_t ch, float *grams);
+
+/*
+ * Calibration is restored from settings at boot and set with the "hx711"
+ * shell command: "hx711 tare <ch>" with the scale empty, then
+ * "hx711 cal <ch> <grams>" with a known mass on it.
+ */
+
+/*
+ * Use the current reading of channel ch as zero. The calibration is
+ * persisted.
+ * Returns 0 on success, or a negative error code.
+ */
+int hx711_tare(uint8_t ch);
+
+/*
+ * Set counts per gram of channel ch from a known mass currently on the
+ * scale. The calibration is persisted.
+ * Returns 0 on success, or a negative error code.
+ */
+int hx711_calibrate(uint8_t ch, float known_grams);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HX711_H_ */
@@ -0,0 +1,41 @@
+#ifndef _LPS28_SAMPLER_H_
+#define _LPS28_SAMPLER_H_
+
+#include <zephyr/types.h>
+#include "lps28.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Background LPS28 sampling with a rate that follows the signal.
+ *
+ * A two-sided CUSUM on the sample-to-sample pressure change decides
+ * whether the pressure is moving (irrigation, drainage). While it is,
+ * the sensor is sampled every LPS28_SAMPLER_FAST_MS; once the signal has
+ * been flat for a while the interval backs off towards
+ * LPS28_SAMPLER_SLOW_MS. Mesh GETs are answered from the latest sample.
+ */
+
+#define LPS28_SAMPLER_FAST_MS   1000
+#define LPS28_SAMPLER_SLOW_MS   60000
+
+/*
+ * Take the first sample and start the periodic sampling work.
+ * lps28_init() must have succeeded before this is called.
+ * Returns 0 on success, or a negative error code.
+ */
+int lps28_sampler_start(void);
+
+/*
+ * Copy the most recent sample into *data.
+ * Returns 0 on success, or -EAGAIN if no sample has been taken yet.
+ */
+int lps28_sampler_latest(struct lps28_data *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LPS28_SAMPLER_H_ */
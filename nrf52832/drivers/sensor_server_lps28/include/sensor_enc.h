@@ -0,0 +1,124 @@
+#ifndef _SENSOR_ENC_H_
+#define _SENSOR_ENC_H_
+
+#include <string.h>
+#include <zephyr/types.h>
+#include <zephyr/sys/byteorder.h>
+#include <bluetooth/mesh/sensor_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Format-specialized sensor value encoders for the handful of formats
+ * this server reports. The generic bt_mesh_sensor_value_from_float()/
+ * _from_micro() look the format up through sensor->type on every call
+ * and go through 64-bit micro-unit scaling; these write the raw bytes
+ * directly. Each one encodes exactly what the generic path would,
+ * including clamping to the format range and returning -ERANGE when it
+ * had to clamp.
+ */
+
+/* Pressure: uint32, 0.1 Pa resolution, so 1 hPa = 1000 raw */
+#define SENSOR_ENC_PRESSURE_RAW_MAX  UINT32_MAX
+
+/* Temperature: sint16, 0.01 degC resolution, 0x8000 = unknown */
+#define SENSOR_ENC_TEMP_RAW_MIN      (-27315)
+#define SENSOR_ENC_TEMP_RAW_MAX      32767
+
+/* Percentage 8: uint8, 0.5 % resolution, 0xff = unknown */
+#define SENSOR_ENC_PERCENT8_RAW_MAX  200
+
+static inline int sensor_enc_pressure_hpa(float hpa, struct bt_mesh_sensor_value *out)
+{
+    /* Clamp in double: (float)UINT32_MAX rounds up to 2^32, out of range */
+    double raw = (double)hpa * 1000.0 + 0.5;
+    int err = 0;
+
+    out->format = &bt_mesh_sensor_format_pressure;
+
+    if (!(raw >= 0.0)) {  /* also catches NaN */
+        raw = 0.0;
+        err = -ERANGE;
+    } else if (raw > (double)SENSOR_ENC_PRESSURE_RAW_MAX) {
+        raw = (double)SENSOR_ENC_PRESSURE_RAW_MAX;
+        err = -ERANGE;
+    }
+
+    sys_put_le32((uint32_t)raw, out->raw);
+    return err;
+}
+
+static inline int sensor_enc_temp_centi(int32_t centi, struct bt_mesh_sensor_value *out)
+{
+    int err = 0;
+
+    out->format = &bt_mesh_sensor_format_temp;
+
+    if (centi < SENSOR_ENC_TEMP_RAW_MIN) {
+        centi = SENSOR_ENC_TEMP_RAW_MIN;
+        err = -ERANGE;
+    } else if (centi > SENSOR_ENC_TEMP_RAW_MAX) {
+        centi = SENSOR_ENC_TEMP_RAW_MAX;
+        err = -ERANGE;
+    }
+
+    sys_put_le16((uint16_t)(int16_t)centi, out->raw);
+    return err;
+}
+
+static inline int sensor_enc_temp_c(float temp_c, struct bt_mesh_sensor_value *out)
+{
+    float centi = temp_c * 100.0f;
+
+    /* Round half away from zero, clamp before the integer conversion */
+    centi += (centi < 0.0f) ? -0.5f : 0.5f;
+    centi = CLAMP(centi, (float)SENSOR_ENC_TEMP_RAW_MIN - 1.0f,
+                  (float)SENSOR_ENC_TEMP_RAW_MAX + 1.0f);
+
+    return sensor_enc_temp_centi((int32_t)centi, out);
+}
+
+/* Float32: IEEE 754 single precision, little endian */
+static inline int sensor_enc_float32(float value, struct bt_mesh_sensor_value *out)
+{
+    uint32_t bits;
+
+    out->format = &bt_mesh_sensor_format_float32;
+    memcpy(&bits, &value, sizeof(bits));
+    sys_put_le32(bits, out->raw);
+    return 0;
+}
+
+/*
+ * Encode num/den as a percentage. den == 0 is encoded as 100 %, which is
+ * what the relative runtime sensors report before the first sample.
+ */
+static inline int sensor_enc_percent8_ratio(uint32_t num, uint32_t den,
+                                            struct bt_mesh_sensor_value *out)
+{
+    uint32_t raw;
+    int err = 0;
+
+    out->format = &bt_mesh_sensor_format_percentage_8;
+
+    if (!den) {
+        raw = SENSOR_ENC_PERCENT8_RAW_MAX;
+    } else {
+        raw = (uint32_t)(((uint64_t)num * SENSOR_ENC_PERCENT8_RAW_MAX + den / 2) / den);
+        if (raw > SENSOR_ENC_PERCENT8_RAW_MAX) {
+            raw = SENSOR_ENC_PERCENT8_RAW_MAX;
+            err = -ERANGE;
+        }
+    }
+
+    out->raw[0] = (uint8_t)raw;
+    return err;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SENSOR_ENC_H_ */
@@ -0,0 +1,88 @@
+#include "gw_path.h"
+#include <zephyr/sys/printk.h>
+#include <zephyr/bluetooth/mesh.h>
+
+/*
+ * Gateway path tracking.
+ *
+ * All of our traffic goes from the sensor servers to one gateway
+ * client. Instead of letting every status flood the network with the
+ * default TTL, the server learns how many hops away the gateway is and
+ * sends its responses with just enough TTL to get there. Relays beyond
+ * that radius drop the status instead of retransmitting it.
+ *
+ * The gateway is identified by the heartbeat subscription source, which
+ * the provisioner sets on each server (Heartbeat Subscription, source =
+ * gateway primary address). The heartbeat gives the hop count directly;
+ * requests from the gateway refresh it from the received TTL, since the
+ * gateway always sends with GW_PATH_REQUEST_TTL.
+ */
+
+static uint8_t gw_hops;
+static uint32_t scoped_rsp_count;
+
+uint16_t gw_path_addr(void)
+{
+    struct bt_mesh_hb_sub sub;
+
+    bt_mesh_hb_sub_get(&sub);
+    return sub.src;
+}
+
+uint8_t gw_path_hops(void)
+{
+    return gw_hops;
+}
+
+static void hb_recv(const struct bt_mesh_hb_sub *sub, uint8_t hops, uint16_t feat)
+{
+    if (hops != gw_hops) {
+        printk("Gateway 0x%04x is %u hop(s) away\n", sub->src, hops);
+    }
+    gw_hops = hops;
+}
+
+static void hb_sub_end(const struct bt_mesh_hb_sub *sub)
+{
+    /* Subscription period ran out: fall back to TTL-based learning */
+    gw_hops = 0;
+}
+
+BT_MESH_HB_CB_DEFINE(gw_path_hb_cb) = {
+    .recv = hb_recv,
+    .sub_end = hb_sub_end,
+};
+
+void gw_path_scope(struct bt_mesh_msg_ctx *ctx)
+{
+    uint16_t gw_addr;
+
+    if (!ctx) {
+        return;
+    }
+
+    gw_addr = gw_path_addr();
+    if (gw_addr == BT_MESH_ADDR_UNASSIGNED || ctx->addr != gw_addr) {
+        /* Unknown requester: keep the default TTL */
+        return;
+    }
+
+    if (ctx->recv_ttl > 0 && ctx->recv_ttl <= GW_PATH_REQUEST_TTL) {
+        gw_hops = GW_PATH_REQUEST_TTL - ctx->recv_ttl + 1;
+    }
+
+    if (!gw_hops) {
+        return;
+    }
+
+    /* A TTL of N reaches a node N hops away: each relay decrements it
+     * once and TTL 1 is still delivered, just not relayed further.
+     */
+    ctx->send_ttl = MIN(gw_hops + GW_PATH_TTL_MARGIN, BT_MESH_TTL_MAX);
+
+    scoped_rsp_count++;
+    if ((scoped_rsp_count % 100) == 1) {
+        printk("Gateway path: %u hop(s), response TTL %u, %u scoped responses\n",
+               gw_hops, ctx->send_ttl, scoped_rsp_count);
+    }
+}
@@ -0,0 +1,107 @@
+#include "lps28_sampler.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+/*
+ * CUSUM tuning, in hPa. DRIFT is the per-sample change we treat as
+ * noise (the LPS28 is good for a few Pa RMS in one-shot mode), and a
+ * change is declared once the accumulated excess passes THRESHOLD.
+ */
+#define CUSUM_DRIFT_HPA         0.02f
+#define CUSUM_THRESHOLD_HPA     0.10f
+
+/* Samples to stay at the fast rate after the last detected change */
+#define FAST_HOLD_SAMPLES       30
+
+/* Flat-signal back-off: interval grows by this factor per quiet sample */
+#define SLOW_DOWN_FACTOR        2
+
+static struct k_work_delayable sample_work;
+static struct k_spinlock lock;
+
+static struct lps28_data latest;
+static bool have_sample;
+
+static uint32_t interval_ms = LPS28_SAMPLER_FAST_MS;
+static uint32_t hold;
+static float cusum_pos;
+static float cusum_neg;
+
+/* Returns true when the CUSUM detects a change in either direction */
+static bool cusum_update(float delta)
+{
+    cusum_pos = MAX(0.0f, cusum_pos + delta - CUSUM_DRIFT_HPA);
+    cusum_neg = MAX(0.0f, cusum_neg - delta - CUSUM_DRIFT_HPA);
+
+    if (cusum_pos > CUSUM_THRESHOLD_HPA || cusum_neg > CUSUM_THRESHOLD_HPA) {
+        cusum_pos = 0.0f;
+        cusum_neg = 0.0f;
+        return true;
+    }
+
+    return false;
+}
+
+static void next_interval(bool changed)
+{
+    uint32_t prev = interval_ms;
+
+    if (changed) {
+        interval_ms = LPS28_SAMPLER_FAST_MS;
+        hold = FAST_HOLD_SAMPLES;
+    } else if (hold) {
+        hold--;
+    } else {
+        interval_ms = MIN(interval_ms * SLOW_DOWN_FACTOR, LPS28_SAMPLER_SLOW_MS);
+    }
+
+    if (interval_ms != prev) {
+        printk("LPS28 sampling interval %u ms -> %u ms\n", prev, interval_ms);
+    }
+}
+
+static void sample(struct k_work *work)
+{
+    struct lps28_data data;
+    bool changed = false;
+    int err;
+
+    err = lps28_fetch(&data);
+    if (err) {
+        printk("Unable to fetch LPS28 data (err=%d)\n", err);
+    } else {
+        k_spinlock_key_t key = k_spin_lock(&lock);
+
+        if (have_sample) {
+            changed = cusum_update(data.press_hpa - latest.press_hpa);
+        }
+        latest = data;
+        have_sample = true;
+
+        k_spin_unlock(&lock, key);
+    }
+
+    next_interval(changed);
+    k_work_schedule(&sample_work, K_MSEC(interval_ms));
+}
+
+int lps28_sampler_start(void)
+{
+    k_work_init_delayable(&sample_work, sample);
+    return k_work_schedule(&sample_work, K_NO_WAIT) < 0 ? -EIO : 0;
+}
+
+int lps28_sampler_latest(struct lps28_data *data)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    int err = 0;
+
+    if (have_sample) {
+        *data = latest;
+    } else {
+        err = -EAGAIN;
+    }
+
+    k_spin_unlock(&lock, key);
+    return err;
+}
@@ -14,10 +14,17 @@
 #include <dk_buttons_and_leds.h>
 #include <zephyr/sys/printk.h>
 #include "model_handler.h"
+#if defined(CONFIG_BOARD_NRF52_BSIM)
+#include "sim_prov.h"
+#endif
 #include "lps28.h"
+#include "lps28_sampler.h"
+#include "hx711.h"
 
 static void bt_ready(int err)
 {
+	const struct bt_mesh_comp *comp;
+
 	if (err) {
 		printk("Bluetooth init failed (err %d)\n", err);
 		return;
@@ -43,7 +50,20 @@ static void bt_ready(int err)
 		return;
 	}
 
-	err = bt_mesh_init(bt_mesh_dk_prov_init(), model_handler_init());
+	err = lps28_sampler_start();
+	if (err) {
+		printk("Starting LPS28 sampler failed (err %d)\n", err);
+		return;
+	}
+
+	/* The node still serves the LPS28 without a load cell attached */
+	err = hx711_init();
+	if (err) {
+		printk("Initializing HX711 failed (err %d)\n", err);
+	}
+
+	comp = model_handler_init();
+	err = bt_mesh_init(bt_mesh_dk_prov_init(), comp);
 	if (err) {
 		printk("Initializing mesh failed (err %d)\n", err);
 		return;
@@ -53,6 +73,14 @@ static void bt_ready(int err)
 		settings_load();
 	}
 
+#if defined(CONFIG_BOARD_NRF52_BSIM)
+	/* No phone in the simulator, see nrf52832/drivers/mesh_bsim */
+	err = sim_prov_start(comp);
+	if (err) {
+		printk("Simulated provisioning failed (err %d)\n", err);
+	}
+#endif
+
 	/* This will be a no-op if settings_load() loaded provisioning info */
 	bt_mesh_prov_enable(BT_MESH_PROV_ADV | BT_MESH_PROV_GATT);
 
@@ -15,6 +15,10 @@
 
 #include "model_handler.h"
 #include "lps28.h"
+#include "lps28_sampler.h"
+#include "hx711.h"
+#include "gw_path.h"
+#include "sensor_enc.h"
 
 #if DT_NODE_HAS_STATUS(DT_NODELABEL(bme680), okay)
 /** Thingy53 */
@@ -33,7 +37,8 @@
 	FIELD_GET(GENMASK(15, 8), (_val) * 100)                                \
 }}
 
-#define COL_INIT(_start, _width) { TEMP_INIT(_start), TEMP_INIT(_width) }
+#define COL_INIT(_start, _width) { TEMP_INIT(_start), TEMP_INIT(_width) },
+#define COL_END_INIT(_start, _width) TEMP_INIT((_start) + (_width)),
 
 #define ILLUMINANCE_INIT_MILLIS(_val)                                          \
 {                                                                              \
@@ -46,13 +51,23 @@
 }
 
 /* The columns (temperature ranges) for relative
- * runtime in a chip temperature
+ * runtime in a chip temperature, as X(start, width)
  */
+#define TEMP_COLUMNS(X)                                                        \
+	X(0, 20)                                                               \
+	X(20, 5)                                                               \
+	X(25, 5)                                                               \
+	X(30, 70)
+
 static const struct bt_mesh_sensor_column columns[] = {
-	COL_INIT(0, 20),
-	COL_INIT(20, 5),
-	COL_INIT(25, 5),
-	COL_INIT(30, 70)
+	TEMP_COLUMNS(COL_INIT)
+};
+
+/* Column ends (start + width), pre-encoded so the series handler
+ * does not decode and re-encode the column bounds on every request.
+ */
+static const struct bt_mesh_sensor_value column_ends[] = {
+	TEMP_COLUMNS(COL_END_INIT)
 };
 
 struct sensor_value_range {
@@ -149,6 +164,8 @@ static int chip_temp_get(struct bt_mesh_sensor_srv *srv,
 	struct sensor_value channel_val;
 	int err;
 
+	gw_path_scope(ctx);
+
 	sensor_sample_fetch(dev);
 
 	err = sensor_channel_get(dev, SENSOR_DATA_TYPE, &channel_val);
@@ -157,8 +174,8 @@ static int chip_temp_get(struct bt_mesh_sensor_srv *srv,
 		return err;
 	}
 
-	err = bt_mesh_sensor_value_from_sensor_value(
-		sensor->type->channels[0].format, &channel_val, rsp);
+	/* val2 is in millionths of a degree, the format resolution is 0.01 degC */
+	err = sensor_enc_temp_centi(channel_val.val1 * 100 + channel_val.val2 / 10000, rsp);
 	if (err && err != -ERANGE) {
 		printk("Error encoding temperature sensor data (%d)\n", err);
 		return err;
@@ -297,9 +314,12 @@ static int lps28_pressure_get(struct bt_mesh_sensor_srv *srv,
 
 	struct lps28_data lps28_readings = { 0 };
 
-    err = lps28_fetch(&lps28_readings);
+	gw_path_scope(ctx);
+
+	/* Served from the background sampler, see lps28_sampler.h */
+	err = lps28_sampler_latest(&lps28_readings);
 	if (err) {
-		printk("Unable to fetch LPS28 data (err=%d)\n", err);
+		printk("No LPS28 sample available yet (err=%d)\n", err);
 	} else {
 		/* Print the floats: note printk with '%.2f' expects doubles, so cast */
 		printk("Pressure: %.2f hPa\n",
@@ -308,7 +328,7 @@ static int lps28_pressure_get(struct bt_mesh_sensor_srv *srv,
 
 	float pressure = lps28_readings.press_hpa;
 
-    return bt_mesh_sensor_value_from_float(sensor->type->channels[0].format, pressure, rsp);
+	return sensor_enc_pressure_hpa(pressure, rsp);
 }
 
 static int lps28_temp_get(struct bt_mesh_sensor_srv *srv,
@@ -319,9 +339,12 @@ static int lps28_temp_get(struct bt_mesh_sensor_srv *srv,
     int err;
 	struct lps28_data lps28_readings = { 0 };
 
-    err = lps28_fetch(&lps28_readings);
+	gw_path_scope(ctx);
+
+	/* Served from the background sampler, see lps28_sampler.h */
+	err = lps28_sampler_latest(&lps28_readings);
 	if (err) {
-		printk("Unable to fetch LPS28 data (err=%d)\n", err);
+		printk("No LPS28 sample available yet (err=%d)\n", err);
 	} else {
 		/* Print the floats: note printk with '%.2f' expects doubles, so cast */
 		printk("Temp: %.2f °C\n",
@@ -330,7 +353,7 @@ static int lps28_temp_get(struct bt_mesh_sensor_srv *srv,
 
 	float temp = lps28_readings.temp_c;
 
-    return bt_mesh_sensor_value_from_float(sensor->type->channels[0].format, temp, rsp);
+	return sensor_enc_temp_c(temp, rsp);
 }
 
 
@@ -345,46 +368,87 @@ static struct bt_mesh_sensor lps28_press = {
     .get = lps28_pressure_get,
 };
 
-static int relative_runtime_in_chip_temp_series_get(struct bt_mesh_sensor_srv *srv,
-	struct bt_mesh_sensor *sensor,
-	struct bt_mesh_msg_ctx *ctx,
-	uint32_t column_index,
-	struct bt_mesh_sensor_value *value)
+// HX711 load cell
+#if HX711_CHANNELS > 0
+/* Lysimeter mass in grams. There is no SIG-assigned mass property, so this
+ * uses an ID from outside the assigned range. sensor_client_network
+ * registers the same type; keep the ID and format in sync.
+ */
+#define LYSIMETER_PROP_ID_MASS 0x7F01
+
+static const struct bt_mesh_sensor_channel mass_channel = {
+    .format = &bt_mesh_sensor_format_float32,
+};
+
+static const struct bt_mesh_sensor_type mass_type = {
+    .id = LYSIMETER_PROP_ID_MASS,
+    .channels = &mass_channel,
+    .channel_count = 1,
+};
+
+static struct bt_mesh_sensor hx711_mass[HX711_CHANNELS];
+
+static int hx711_mass_get(struct bt_mesh_sensor_srv *srv,
+                          struct bt_mesh_sensor *sensor,
+                          struct bt_mesh_msg_ctx *ctx,
+                          struct bt_mesh_sensor_value *rsp)
 {
 	int err;
+	float grams;
 
-	if (tot_temp_samps) {
-		int64_t percent_micros =
-			(BASE_UNITS_TO_MICRO(100) * col_samps[column_index]) / tot_temp_samps;
+	/* One sensor per load cell, in channel order */
+	uint8_t ch = sensor - hx711_mass;
 
-		err = bt_mesh_sensor_value_from_micro(sensor->type->channels[0].format,
-						      percent_micros, &value[0]);
-		if (err && err != -ERANGE) {
-			printk("Error encoding relative runtime in chip temp series (%d)\n", err);
-			return err;
-		}
-	} else {
-		err = bt_mesh_sensor_value_from_micro(sensor->type->channels[0].format,
-						      0, &value[0]);
-		if (err && err != -ERANGE) {
-			printk("Error encoding relative runtime in chip temp series (%d)\n", err);
-			return err;
-		}
+	gw_path_scope(ctx);
+
+	err = hx711_grams_get(ch, &grams);
+	if (err) {
+		printk("No HX711 %d reading available yet (err=%d)\n", ch, err);
+		return err;
 	}
 
-	value[1] = columns[column_index].start;
+	printk("Mass %d: %.1f g\n", ch, (double)grams);
+
+	return sensor_enc_float32(grams, rsp);
+}
+
+/* The HX711 averages 16 conversions at 10 SPS */
+static const struct bt_mesh_sensor_descriptor mass_descriptor = {
+	.sampling_type = BT_MESH_SENSOR_SAMPLING_ARITHMETIC_MEAN,
+	.period = 1600,
+	.update_interval = 100,
+};
+
+#define HX711_MASS_INIT(_ch, _) {                                             \
+    .type = &mass_type,                                                       \
+    .get = hx711_mass_get,                                                    \
+    .descriptor = &mass_descriptor,                                           \
+}
+
+static struct bt_mesh_sensor hx711_mass[HX711_CHANNELS] = {
+    LISTIFY(HX711_CHANNELS, HX711_MASS_INIT, (,))
+};
+#endif /* HX711_CHANNELS > 0 */
 
-	int64_t start_micro, width_micro;
+static int relative_runtime_in_chip_temp_series_get(struct bt_mesh_sensor_srv *srv,
+	struct bt_mesh_sensor *sensor,
+	struct bt_mesh_msg_ctx *ctx,
+	uint32_t column_index,
+	struct bt_mesh_sensor_value *value)
+{
+	int err;
 
-	(void)bt_mesh_sensor_value_to_micro(&columns[column_index].start, &start_micro);
-	(void)bt_mesh_sensor_value_to_micro(&columns[column_index].width, &width_micro);
-	err = bt_mesh_sensor_value_from_micro(columns[column_index].start.format,
-					      start_micro + width_micro, &value[2]);
+	/* No samples yet reports 0 % for every column */
+	err = sensor_enc_percent8_ratio(col_samps[column_index],
+					tot_temp_samps ? tot_temp_samps : 1, &value[0]);
 	if (err && err != -ERANGE) {
-		printk("Error encoding column end (%d)\n", err);
+		printk("Error encoding relative runtime in chip temp series (%d)\n", err);
 		return err;
 	}
 
+	value[1] = columns[column_index].start;
+	value[2] = column_ends[column_index];
+
 	return 0;
 }
 
@@ -395,24 +459,14 @@ static int relative_runtime_in_chip_temp_get(struct bt_mesh_sensor_srv *srv,
 {
 	int err;
 
-	if (tot_temp_samps) {
-		int64_t percent_micros =
-			(BASE_UNITS_TO_MICRO(100) * (tot_temp_samps - outside_temp_range)) /
-			tot_temp_samps;
+	gw_path_scope(ctx);
 
-		err = bt_mesh_sensor_value_from_micro(sensor->type->channels[0].format,
-						      percent_micros, &rsp[0]);
-		if (err && err != -ERANGE) {
-			printk("Error encoding relative runtime in chip temp (%d)\n", err);
-			return err;
-		}
-	} else {
-		err = bt_mesh_sensor_value_from_micro(sensor->type->channels[0].format,
-						      BASE_UNITS_TO_MICRO(100), &rsp[0]);
-		if (err && err != -ERANGE) {
-			printk("Error encoding relative runtime in chip temp series (%d)\n", err);
-			return err;
-		}
+	/* No samples yet reports 100 % in range */
+	err = sensor_enc_percent8_ratio(tot_temp_samps - outside_temp_range, tot_temp_samps,
+					&rsp[0]);
+	if (err && err != -ERANGE) {
+		printk("Error encoding relative runtime in chip temp (%d)\n", err);
+		return err;
 	}
 
 	rsp[1] = temp_range.start;
@@ -440,6 +494,8 @@ static int people_count_get(struct bt_mesh_sensor_srv *srv,
 		bt_mesh_sensor_value_from_micro(sensor->type->channels[0].format,
 						BASE_UNITS_TO_MICRO(dummy_people_count_value), rsp);
 
+	gw_path_scope(ctx);
+
 	if (err && err != -ERANGE) {
 		printk("Error encoding people count (%d)", err);
 		return err;
@@ -547,6 +603,8 @@ static int presence_detected_get(struct bt_mesh_sensor_srv *srv,
 	int err = bt_mesh_sensor_value_from_micro(sensor->type->channels[0].format,
 						  BASE_UNITS_TO_MICRO(pres_detect ? 1 : 0), rsp);
 
+	gw_path_scope(ctx);
+
 	if (err && err != -ERANGE) {
 		printk("Error encoding presence detected (%d)\n", err);
 		return err;
@@ -599,6 +657,8 @@ static int time_since_presence_detected_get(struct bt_mesh_sensor_srv *srv,
 	int err;
 	const struct bt_mesh_sensor_format *format = sensor->type->channels[0].format;
 
+	gw_path_scope(ctx);
+
 	if (pres_detect) {
 		err = bt_mesh_sensor_value_from_micro(format, 0, rsp);
 	} else {
@@ -624,6 +684,8 @@ static int motion_sensed_get(struct bt_mesh_sensor_srv *srv, struct bt_mesh_sens
 	int err = bt_mesh_sensor_value_from_float(sensor->type->channels[0].format,
 						  dummy_motion_value, rsp);
 
+	gw_path_scope(ctx);
+
 	if (err && err != -ERANGE) {
 		printk("Error encoding motion sensed (%d)", err);
 		return err;
@@ -643,6 +705,8 @@ static int time_since_motion_sensed_get(struct bt_mesh_sensor_srv *srv,
 	int err;
 	const struct bt_mesh_sensor_format *format = sensor->type->channels[0].format;
 
+	gw_path_scope(ctx);
+
 	if (!!dummy_motion_value) {
 		err = bt_mesh_sensor_value_from_micro(format, 0, rsp);
 	} else {
@@ -808,6 +872,8 @@ static int amb_light_level_get(struct bt_mesh_sensor_srv *srv,
 {
 	int err;
 
+	gw_path_scope(ctx);
+
 	/* Report ambient light as dummy value, and changing it by pressing
 	 * a button. The logic and hardware for measuring the actual ambient
 	 * light usage of the device should be implemented here.
@@ -877,6 +943,19 @@ static struct bt_mesh_sensor *const lps28_pressure_sensor[] = {
 	&lps28_press,
 };
 
+/* A property can only appear once per element, so every load cell gets a
+ * sensor server on its own element.
+ */
+#define HX711_MASS_SRV_DEFINE(_ch, _)                                         \
+	static struct bt_mesh_sensor *const hx711_mass_sensor_##_ch[] = {    \
+		&hx711_mass[_ch],                                             \
+	};                                                                    \
+	static struct bt_mesh_sensor_srv hx711_mass_sensor_srv_##_ch =       \
+		BT_MESH_SENSOR_SRV_INIT(hx711_mass_sensor_##_ch,              \
+					ARRAY_SIZE(hx711_mass_sensor_##_ch));
+
+LISTIFY(HX711_CHANNELS, HX711_MASS_SRV_DEFINE, ())
+
 static struct bt_mesh_sensor_srv ambient_light_sensor_srv =
 	BT_MESH_SENSOR_SRV_INIT(ambient_light_sensor, ARRAY_SIZE(ambient_light_sensor));
 static struct bt_mesh_sensor_srv presence_sensor_srv =
@@ -1150,9 +1229,26 @@ static struct bt_mesh_health_srv health_srv = {
 
 BT_MESH_HEALTH_PUB_DEFINE(health_pub, 0);
 
+#if defined(CONFIG_BT_MESH_CFG_CLI)
+/* Only for self-configuration in the BabbleSim benchmark */
+static struct bt_mesh_cfg_cli cfg_cli;
+#endif
+
+/* Load cell elements follow the LPS28 ones: mass channel n is on element
+ * offset 7 + n. Each carries its own separator, so a board without an
+ * HX711 adds nothing to the list.
+ */
+#define HX711_MASS_ELEM(_ch, _)                                               \
+	BT_MESH_ELEM(8 + (_ch),                                               \
+		     BT_MESH_MODEL_LIST(BT_MESH_MODEL_SENSOR_SRV(             \
+			     &hx711_mass_sensor_srv_##_ch)),                   \
+		     BT_MESH_MODEL_NONE),
+
 static struct bt_mesh_elem elements[] = {
 	BT_MESH_ELEM(1,
 		     BT_MESH_MODEL_LIST(BT_MESH_MODEL_CFG_SRV,
+					IF_ENABLED(CONFIG_BT_MESH_CFG_CLI,
+						   (BT_MESH_MODEL_CFG_CLI(&cfg_cli),))
 					BT_MESH_MODEL_HEALTH_SRV(&health_srv,
 								 &health_pub),
 					BT_MESH_MODEL_SENSOR_SRV(&ambient_light_sensor_srv)),
@@ -1175,6 +1271,7 @@ static struct bt_mesh_elem elements[] = {
 	BT_MESH_ELEM(7,
 		     BT_MESH_MODEL_LIST(BT_MESH_MODEL_SENSOR_SRV(&lps28_pressure_sensor_srv)),
 		     BT_MESH_MODEL_NONE),
+	LISTIFY(HX711_CHANNELS, HX711_MASS_ELEM, ())
 };
 
 static const struct bt_mesh_comp comp = {
@@ -0,0 +1,499 @@
+"""Decoder for the binary records sensor_client_network writes to its UART.
+
+Frames are COBS encoded and delimited by 0x00 bytes; everything between
+frames is the gateway's printk text. See
+nrf52832/drivers/sensor_client_network/include/frame.h for the layout.
+Keep FRAME_VERSION and PROPERTIES in sync with the firmware.
+
+Run it as a logger, like uart_logger.py: every reading becomes one row of
+OUTPUT_CSV, and the text lines are printed as they come. Series entries
+(histogram columns, history buckets) become rows too, with status
+"series" and the column in the name. Each reading carries the RSSI and
+TTL its status arrived with and the hop count to its server. The path
+statistics of each server (loss, latency, RSSI, hops) go to
+OUTPUT_PATH_CSV, one row per cycle it was polled in. On start and
+after the port comes back, the logger asks the gateway to replay what it
+missed with "RESUME <seq>", taking the last seq from OUTPUT_CSV.
+
+With --plan FILE it first pushes a new poll plan to the gateway, which
+keeps it across reboots. FILE is JSON, every key optional:
+
+    {"timeout_ms": 2000, "only_listed": true, "servers": ["0x0002"],
+     "props": [{"prop_id": "0x2A6D", "period_ms": 5000, "timeout_ms": 1500},
+               {"prop_id": "0x0054", "period_ms": 0}]}
+
+A period_ms of 0 stops polling that property; an empty plan goes back to
+the built-in poll classes.
+"""
+import argparse
+import csv
+import json
+import struct
+import time
+
+# CONFIGURE:
+UART_PORT = '/dev/ttyACM0'  # or your actual port
+BAUDRATE = 115200
+OUTPUT_CSV = 'sensor_frames.csv'
+OUTPUT_PATH_CSV = 'sensor_paths.csv'
+
+FRAME_VERSION = 2
+
+FRAME_TYPE_READINGS = 0x01
+FRAME_TYPE_SERIES = 0x02
+FRAME_TYPE_PATH = 0x03
+FRAME_TYPE_PLAN = 0x81
+
+PLAN_ONLY_LISTED = 0x01
+
+# Gaps and seen frames are remembered this many seqs back, well beyond
+# what the gateway holds for replay
+SEQ_WINDOW = 1024
+
+STATUS_NAMES = {
+    0: 'ok',
+    1: 'timeout',
+    2: 'failed',
+    3: 'skipped',
+}
+
+HEADER = struct.Struct('<BBHI')      # version, type, seq, timestamp_ms
+READINGS = struct.Struct('<HB')      # server, count
+READING = struct.Struct('<HHBHbBBB')  # addr, prop_id, status, age_ms, rssi, ttl, hops, len
+PATH = struct.Struct('<HBIIIIIHHHBBbbbI')
+PATH_FIELDS = ['server', 'up', 'tx', 'rx', 'lost', 'late', 'dup', 'rtt_p50_ms',
+               'rtt_p90_ms', 'rtt_max_ms', 'ttl', 'hops', 'rssi_avg', 'rssi_min',
+               'rssi_max', 'rssi_count']
+SERIES = struct.Struct('<HHBB')      # addr, prop_id, total, count
+PLAN = struct.Struct('<HBB')         # timeout_ms, flags, server_count
+PLAN_PROP = struct.Struct('<HIH')    # prop_id, period_ms, timeout_ms
+
+CSV_HEADER = ['gateway_ms', 'seq', 'server', 'addr', 'prop_id', 'name',
+              'status', 'age_ms', 'value', 'rssi', 'ttl', 'hops']
+PATH_CSV_HEADER = ['gateway_ms', 'seq'] + PATH_FIELDS
+
+
+def _uint(raw, unknown, scale):
+    val = int.from_bytes(raw, 'little')
+    return None if val == unknown else val * scale
+
+
+def _sint(raw, unknown, scale):
+    val = int.from_bytes(raw, 'little', signed=True)
+    return None if val == unknown else val * scale
+
+
+# Mesh device property ID -> (column name, decoder of the raw value).
+# Decoders return None for the property's "value is not known" encoding.
+PROPERTIES = {
+    0x004E: ('Ambient Light', lambda r: _uint(r, 0xFFFFFF, 0.01)),        # lux
+    0x004D: ('Presence', lambda r: bool(r[0])),
+    0x0068: ('Time Since Motion', lambda r: _uint(r, 0xFFFF, 1)),         # s
+    0x004C: ('People Count', lambda r: _uint(r, 0xFFFF, 1)),
+    0x0054: ('Chip Temp', lambda r: _sint(r, -0x8000, 0.01)),             # degC
+    0x004F: ('Sensor Temp', lambda r: _sint(r, 0x7F, 0.5)),               # degC
+    0x2A6D: ('Pressure', lambda r: _uint(r, None, 0.1)),                  # Pa
+    0x7F01: ('Mass', lambda r: struct.unpack('<f', r)[0]),                # g
+    0x0064: ('Runtime In Chip Temp', lambda r: _uint(r, 0xFF, 0.5)),      # %
+}
+
+# Series property ID -> decoder of its column channels, for the column
+# bounds in the row name
+SERIES_COLUMNS = {
+    0x0064: lambda r: _sint(r, -0x8000, 0.01),                            # degC
+}
+
+
+def crc16_mcrf4xx(data, crc=0xFFFF):
+    """CRC-16/MCRF4XX, the same as Zephyr's crc16_ccitt(0xFFFF, ...)"""
+    for byte in data:
+        e = (crc ^ byte) & 0xFF
+        f = (e ^ (e << 4)) & 0xFF
+        crc = (crc >> 8) ^ (f << 8) ^ (f << 3) ^ (f >> 4)
+    return crc & 0xFFFF
+
+
+def cobs_decode(data):
+    """Undo COBS. Raises ValueError on a malformed block."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError('bad COBS block')
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def cobs_encode(data):
+    out = bytearray()
+    block = bytearray()
+    for i, byte in enumerate(data):
+        if byte:
+            block.append(byte)
+        # A full block at the very end needs no empty one after it
+        if not byte or (len(block) == 0xFE and i + 1 < len(data)):
+            out.append(len(block) + 1)
+            out += block
+            block.clear()
+    out.append(len(block) + 1)
+    out += block
+    return bytes(out)
+
+
+def build_frame(ftype, seq, payload):
+    """A frame for the gateway, delimiters included"""
+    frame = HEADER.pack(FRAME_VERSION, ftype, seq & 0xFFFF, 0) + payload
+    frame += struct.pack('<H', crc16_mcrf4xx(frame))
+    return b'\x00' + cobs_encode(frame) + b'\x00'
+
+
+def _int(value):
+    return int(value, 0) if isinstance(value, str) else int(value)
+
+
+def plan_payload(plan):
+    """FRAME_TYPE_PLAN payload from a plan as described at the top"""
+    servers = [_int(a) for a in plan.get('servers', [])]
+    props = plan.get('props', [])
+    flags = PLAN_ONLY_LISTED if plan.get('only_listed') else 0
+
+    out = PLAN.pack(_int(plan.get('timeout_ms', 0)), flags, len(servers))
+    out += b''.join(struct.pack('<H', a) for a in servers)
+    out += struct.pack('<B', len(props))
+    for prop in props:
+        out += PLAN_PROP.pack(_int(prop['prop_id']),
+                              _int(prop.get('period_ms', 0)),
+                              _int(prop.get('timeout_ms', 0)))
+    return out
+
+
+def decode_value(prop_id, raw):
+    name, decoder = PROPERTIES.get(prop_id, ('0x%04X' % prop_id, None))
+    if decoder is None or not raw:
+        return name, raw.hex() if raw else None
+    try:
+        return name, decoder(raw)
+    except (IndexError, struct.error):
+        return name, raw.hex()
+
+
+def parse_frame(payload):
+    """Parse a decoded frame. Returns a dict, or None if the CRC or the
+    version does not match. Frames of an unknown type come back with just
+    the header fields.
+    """
+    if len(payload) < HEADER.size + 2:
+        return None
+
+    body, crc = payload[:-2], struct.unpack('<H', payload[-2:])[0]
+    if crc16_mcrf4xx(body) != crc:
+        return None
+
+    version, ftype, seq, timestamp = HEADER.unpack_from(body)
+    if version != FRAME_VERSION:
+        return None
+
+    frame = {'type': ftype, 'seq': seq, 'timestamp_ms': timestamp}
+    pos = HEADER.size
+
+    if ftype == FRAME_TYPE_READINGS:
+        server, count = READINGS.unpack_from(body, pos)
+        pos += READINGS.size
+        readings = []
+        for _ in range(count):
+            addr, prop_id, status, age, rssi, ttl, hops, length = \
+                READING.unpack_from(body, pos)
+            pos += READING.size
+            raw = body[pos:pos + length]
+            pos += length
+            name, value = decode_value(prop_id, raw)
+            readings.append({
+                'addr': addr,
+                'prop_id': prop_id,
+                'name': name,
+                'status': STATUS_NAMES.get(status, str(status)),
+                'age_ms': age,
+                'value': value,
+                'rssi': rssi if status == 0 else None,
+                'ttl': ttl if status == 0 else None,
+                'hops': hops or None,
+            })
+        frame['server'] = server
+        frame['readings'] = readings
+
+    elif ftype == FRAME_TYPE_SERIES:
+        addr, prop_id, total, count = SERIES.unpack_from(body, pos)
+        pos += SERIES.size
+        entries = []
+        for _ in range(count):
+            index, channels = struct.unpack_from('<BB', body, pos)
+            pos += 2
+            raws = []
+            for _ in range(channels):
+                length = body[pos]
+                raws.append(body[pos + 1:pos + 1 + length])
+                pos += 1 + length
+            entries.append({'index': index, 'channels': raws})
+        frame['server'] = addr
+        frame['series'] = {'addr': addr, 'prop_id': prop_id, 'total': total,
+                           'entries': entries}
+
+    elif ftype == FRAME_TYPE_PATH:
+        path = dict(zip(PATH_FIELDS, PATH.unpack_from(body, pos)))
+        frame['server'] = path['server']
+        frame['path'] = path
+
+    return frame
+
+
+class FrameReader:
+    """Splits the UART byte stream into frames and text.
+
+    feed() returns a list of ('frame', dict) and ('text', str) items.
+    A chunk between 0x00 delimiters is a frame if its first decoded byte
+    is FRAME_VERSION, which is not a printable character; anything else
+    is the gateway's printk output. Frames that fail the CRC are counted
+    in self.bad.
+
+    Frames are tracked by seq. Gaps go into self.missing, and a replayed
+    frame that fills one is passed on and counted in self.recovered. A
+    replay carries the original timestamp, so a frame with a seq and
+    timestamp seen before is dropped and counted in self.dups. A frame
+    that is neither newer nor a gap means the gateway restarted its seq,
+    and tracking starts over. Pass the last seq already stored as
+    resume_from, so that the replay of everything after it is expected.
+    """
+
+    def __init__(self, resume_from=None):
+        self.buf = bytearray()
+        self.next_seq = None if resume_from is None else (resume_from + 1) & 0xFFFF
+        self.missing = set()
+        self.seen = {}          # seq -> timestamp_ms
+        self.newest_ts = None
+        self.frames = 0
+        self.recovered = 0
+        self.dups = 0
+        self.bad = 0
+
+    @property
+    def lost(self):
+        return len(self.missing)
+
+    def resume_point(self):
+        """Seq to send with RESUME: everything after it is wanted"""
+        if self.next_seq is None:
+            return None
+        if self.missing:
+            # Oldest gap, in seq order relative to next_seq
+            oldest = max(self.missing, key=lambda s: (self.next_seq - s) & 0xFFFF)
+            return (oldest - 1) & 0xFFFF
+        return (self.next_seq - 1) & 0xFFFF
+
+    def _accept(self, seq, timestamp):
+        if self.seen.get(seq) == timestamp:
+            self.dups += 1
+            return False
+
+        if seq in self.missing:
+            self.missing.discard(seq)
+            self.recovered += 1
+        elif self.next_seq is None:
+            self.next_seq = (seq + 1) & 0xFFFF
+            self.newest_ts = timestamp
+        elif ((seq - self.next_seq) & 0xFFFF) < 0x8000 and \
+                (self.newest_ts is None or timestamp >= self.newest_ts):
+            ahead = (seq - self.next_seq) & 0xFFFF
+            self.missing.update((self.next_seq + k) & 0xFFFF for k in range(ahead))
+            self.next_seq = (seq + 1) & 0xFFFF
+            self.newest_ts = timestamp
+        else:
+            # Gateway restarted, start over from this frame
+            self.missing.clear()
+            self.seen.clear()
+            self.next_seq = (seq + 1) & 0xFFFF
+            self.newest_ts = timestamp
+
+        self.seen[seq] = timestamp
+
+        # Forget what is too old to ever be replayed
+        def recent(s):
+            return (self.next_seq - 1 - s) & 0xFFFF < SEQ_WINDOW
+        if len(self.seen) > 2 * SEQ_WINDOW:
+            self.seen = {s: t for s, t in self.seen.items() if recent(s)}
+        self.missing = {s for s in self.missing if recent(s)}
+        return True
+
+    def feed(self, data):
+        items = []
+        self.buf += data
+        while True:
+            end = self.buf.find(0)
+            if end < 0:
+                break
+            chunk = bytes(self.buf[:end])
+            del self.buf[:end + 1]
+            if chunk:
+                items.extend(self._chunk(chunk))
+        return items
+
+    def _chunk(self, chunk):
+        try:
+            payload = cobs_decode(chunk)
+        except ValueError:
+            payload = b''
+
+        if payload[:1] != bytes([FRAME_VERSION]):
+            text = chunk.decode('utf-8', errors='replace')
+            return [('text', line) for line in text.splitlines() if line.strip()]
+
+        try:
+            frame = parse_frame(payload)
+        except struct.error:
+            frame = None
+        if frame is None:
+            self.bad += 1
+            return []
+
+        if not self._accept(frame['seq'], frame['timestamp_ms']):
+            return []
+        self.frames += 1
+        return [('frame', frame)]
+
+
+def series_rows(frame):
+    """CSV rows, one per series entry, named "<name>[<index>] <column>" """
+    series = frame['series']
+    prop_id = series['prop_id']
+    column = SERIES_COLUMNS.get(prop_id)
+    rows = []
+    for entry in series['entries']:
+        raws = entry['channels']
+        name, value = decode_value(prop_id, raws[0] if raws else b'')
+        bounds = []
+        for raw in raws[1:]:
+            try:
+                bounds.append(str(column(raw)) if column else raw.hex())
+            except (IndexError, struct.error):
+                bounds.append(raw.hex())
+        rows.append([frame['timestamp_ms'], frame['seq'], '0x%04X' % series['addr'],
+                     '0x%04X' % series['addr'], '0x%04X' % prop_id,
+                     f"{name}[{entry['index']}] {'..'.join(bounds)}".rstrip(),
+                     'series', 0, '' if value is None else value, '', '', ''])
+    return rows
+
+
+def _blank(value):
+    return '' if value is None else value
+
+
+def frame_rows(frame):
+    """CSV rows, one per reading or series entry, in CSV_HEADER order"""
+    if 'series' in frame:
+        return series_rows(frame)
+    return [[frame['timestamp_ms'], frame['seq'], '0x%04X' % frame['server'],
+             '0x%04X' % r['addr'], '0x%04X' % r['prop_id'], r['name'],
+             r['status'], r['age_ms'], _blank(r['value']),
+             _blank(r['rssi']), _blank(r['ttl']), _blank(r['hops'])]
+            for r in frame.get('readings', [])]
+
+
+def path_row(frame):
+    """The PATH_CSV_HEADER row of a FRAME_TYPE_PATH frame"""
+    path = dict(frame['path'], server='0x%04X' % frame['path']['server'])
+    return [frame['timestamp_ms'], frame['seq']] + [path[k] for k in PATH_FIELDS]
+
+
+def last_stored_seq(path):
+    """seq of the last row of a CSV written by this logger, or None"""
+    try:
+        with open(path, newline='') as f:
+            last = None
+            for row in csv.reader(f):
+                last = row
+    except FileNotFoundError:
+        return None
+    try:
+        return int(last[CSV_HEADER.index('seq')])
+    except (TypeError, ValueError, IndexError):
+        return None
+
+
+def open_port(reader):
+    import serial
+
+    ser = serial.Serial(UART_PORT, BAUDRATE, timeout=1)
+    print(f"Listening on {UART_PORT} at {BAUDRATE} baud")
+
+    seq = reader.resume_point()
+    if seq is not None:
+        ser.write(f"RESUME {seq}\n".encode())
+        print(f"Asked the gateway to replay from seq {seq}")
+    return ser
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--plan', metavar='FILE',
+                        help='push this poll plan to the gateway first')
+    args = parser.parse_args()
+
+    reader = FrameReader(resume_from=last_stored_seq(OUTPUT_CSV))
+    ser = open_port(reader)
+
+    if args.plan:
+        with open(args.plan) as plan_file:
+            payload = plan_payload(json.load(plan_file))
+        # The gateway answers with a "PLAN <seq> ok" or "ERR PLAN" line
+        ser.write(build_frame(FRAME_TYPE_PLAN, int(time.time()), payload))
+        print(f"Sent poll plan from {args.plan}")
+
+    with open(OUTPUT_CSV, 'a', newline='') as f, \
+            open(OUTPUT_PATH_CSV, 'a', newline='') as path_f:
+        writer = csv.writer(f)
+        f.seek(0, 2)
+        if f.tell() == 0:
+            writer.writerow(CSV_HEADER)
+        path_writer = csv.writer(path_f)
+        path_f.seek(0, 2)
+        if path_f.tell() == 0:
+            path_writer.writerow(PATH_CSV_HEADER)
+
+        while True:
+            try:
+                if ser is None:
+                    ser = open_port(reader)
+                data = ser.read(ser.in_waiting or 1)
+                for kind, item in reader.feed(data):
+                    if kind == 'text':
+                        print(f"RAW: {item}")
+                        continue
+                    if 'path' in item:
+                        path_writer.writerow(path_row(item))
+                        path_f.flush()
+                        continue
+                    rows = frame_rows(item)
+                    writer.writerows(rows)
+                    f.flush()
+                    what = 'series entries' if 'series' in item else 'readings'
+                    print(f"Frame {item['seq']} from 0x{item.get('server', 0):04X}: "
+                          f"{len(rows)} {what} (lost {reader.lost}, "
+                          f"recovered {reader.recovered}, bad {reader.bad})")
+
+            except KeyboardInterrupt:
+                print("\nExiting.")
+                break
+            except Exception as e:
+                # Cable pulled or gateway reset: reopen, then catch up
+                print(f"ERROR: {e}")
+                if ser is not None:
+                    ser.close()
+                ser = None
+                time.sleep(1)  # pause on error
+
+
+if __name__ == '__main__':
+    main()